@@ -0,0 +1,436 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Headless command-line tools for measuring the cost of the different walks.
+******************************************************************************/
+
+#include <iostream>
+#include <sstream>
+#include <boost/format.hpp>
+
+#include "benchmark.h"
+#include "kernels.h"
+
+/*****************************************************************************/
+
+static void quietMessageHandler(QtMsgType type, const char* msg)
+{
+    if (type != QtDebugMsg)
+        std::cerr << msg << std::endl;
+}
+
+/*****************************************************************************/
+
+const char* strategyName(int strategy)
+{
+    switch (strategy)
+    {
+        case STRAIGHT_WALK:   return "straight";
+        case VISIBILITY_WALK: return "visibility";
+        case PIVOT_WALK:      return "pivot";
+        default:              return "unknown";
+    }
+}
+
+/*****************************************************************************/
+
+void silenceDebugOutput()
+{
+    qInstallMsgHandler(quietMessageHandler);
+}
+
+/*****************************************************************************/
+
+// Return the argument following name, or defaultValue if it is not present.
+QString argValue(const QStringList& args,
+                 const QString&     name,
+                 const QString&     defaultValue)
+{
+    int i = args.indexOf(name);
+    if (i < 0 || i+1 >= args.size())
+        return defaultValue;
+    return args[i+1];
+}
+
+/*****************************************************************************/
+
+// Parse a comma separated list of integers, such as "1000,10000".
+QList<int> argIntList(const QStringList& args,
+                      const QString&     name,
+                      const QString&     defaultValue)
+{
+    QList<int> values;
+    QStringList items = argValue(args, name, defaultValue).split(",");
+    for (int i=0; i<items.size(); i++)
+        values.append(items[i].toInt());
+    return values;
+}
+
+/*****************************************************************************/
+
+// Parse --distributions, given by name. Defaults to all of them.
+QList<int> argDistributions(const QStringList& args)
+{
+    QList<int> values;
+    QStringList names = argValue(args, "--distributions", "all").split(",");
+
+    for (int d=0; d<NUM_DISTRIBUTIONS; d++)
+        if (names.contains("all") || names.contains(distributionName(d)))
+            values.append(d);
+
+    return values;
+}
+
+/*****************************************************************************/
+
+// Produce a strategy x distribution x n matrix of walk costs.
+//
+//  --n              Comma separated list of triangulation sizes.
+//  --queries        Number of walks per cell of the matrix.
+//  --seed           Seed for both the pointsets and the queries.
+//  --distributions  Comma separated list of distribution names, or "all".
+int runBenchmark(const QStringList& args)
+{
+    QList<int>   sizes         = argIntList(args, "--n", "1000,10000,100000");
+    QList<int>   distributions = argDistributions(args);
+    int          queries       = argValue(args, "--queries", "1000").toInt();
+    unsigned int seed          = argValue(args, "--seed",    "1"   ).toUInt();
+
+    silenceDebugOutput();
+
+    // The pivot walk statistics are printed as a second table.
+    std::ostringstream pivots;
+    pivots << boost::format("%-10s %10s %12s %12s %12s %12s %10s\n")
+              % "points" % "n" % "pivots" % "tri/pivot" % "saved"
+              % "lost" % "complete";
+
+    std::cout << boost::format("%-12s %-10s %10s %12s %12s %12s %12s\n")
+                 % "strategy" % "points" % "n"
+                 % "ns/query" % "orient/query" % "tri/query"
+                 % "cached";
+
+    for (int d=0; d<distributions.size(); d++)
+    {
+        for (int s=0; s<sizes.size(); s++)
+        {
+            Delaunay dt;
+            buildTriangulation(&dt, distributions[d], sizes[s], seed);
+
+            std::vector<Point>       targets;
+            std::vector<Face_handle> starts;
+            makeQueries(&dt, distributions[d], queries, seed, targets, starts);
+
+            WalkCost cost[NUM_STRATEGIES];
+            cost[STRAIGHT_WALK]   = measureWalks< StraightWalk<Delaunay>   >
+                                                    (&dt, targets, starts);
+            cost[VISIBILITY_WALK] = measureWalks< VisibilityWalk<Delaunay> >
+                                                    (&dt, targets, starts);
+            cost[PIVOT_WALK]      = measureWalks< PivotWalk<Delaunay>      >
+                                                    (&dt, targets, starts);
+
+            for (int w=0; w<NUM_STRATEGIES; w++)
+            {
+                // Share of the orientations asked for by the walk that the
+                // cache answered.
+                double asked  = cost[w].orientations + cost[w].cacheHits;
+                double cached = asked > 0 ? cost[w].cacheHits / asked : 0;
+
+                std::cout << boost::format("%-12s %-10s %10d %12.1f %12.2f "
+                                           "%12.2f %11.1f%%\n")
+                             % strategyName(w)
+                             % distributionName(distributions[d])
+                             % sizes[s]
+                             % cost[w].ns
+                             % cost[w].orientations
+                             % cost[w].triangles
+                             % (100 * cached);
+            }
+
+            PivotStatistics p = pivotStatistics(&dt, targets, starts);
+            double          q = qMax<size_t>(1, targets.size());
+
+            pivots << boost::format("%-10s %10d %12.2f %12.2f %12.2f %12.2f "
+                                    "%10s\n")
+                      % distributionName(distributions[d])
+                      % sizes[s]
+                      % (p.pivots / q)
+                      % p.trianglesPerPivot()
+                      % (p.saved  / q)
+                      % (p.lost   / q)
+                      % (p.completed ? "yes" : "no");
+        }
+    }
+
+    std::cout << "\n" << pivots.str();
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+// Time construction and every walk for one kernel on the given points. The
+// query pairs are (start, target) points, both inside the hull.
+template <typename Kernel>
+static void benchmarkKernel(const char*                 name,
+                            const std::vector<Point>&   points,
+                            const std::vector<Point>&   queries)
+{
+    typedef CGAL::Delaunay_triangulation_2<Kernel>      Dt;
+    typedef typename Dt::Point                          Dt_point;
+    typedef typename Dt::Face_handle                    Dt_face_handle;
+
+    std::vector<Dt_point> converted(points.size());
+    for (unsigned int i=0; i<points.size(); i++)
+        converted[i] = Dt_point(points[i].x(), points[i].y());
+
+    Dt            dt;
+    QElapsedTimer timer;
+    timer.start();
+    dt.insert(converted.begin(), converted.end());
+    double construct = timer.nsecsElapsed() / 1e6;
+
+    std::vector<Dt_point>       targets;
+    std::vector<Dt_face_handle> starts;
+    for (unsigned int i=0; i+1<queries.size(); i+=2)
+    {
+        starts.push_back (dt.locate(Dt_point(queries[i].x(), 
+                                             queries[i].y())));
+        targets.push_back(Dt_point(queries[i+1].x(), queries[i+1].y()));
+    }
+
+    WalkCost cost[NUM_STRATEGIES];
+    cost[STRAIGHT_WALK]   = measureWalks< StraightWalk<Dt>   >
+                                            (&dt, targets, starts);
+    cost[VISIBILITY_WALK] = measureWalks< VisibilityWalk<Dt> >
+                                            (&dt, targets, starts);
+    cost[PIVOT_WALK]      = measureWalks< PivotWalk<Dt>      >
+                                            (&dt, targets, starts);
+
+    for (int w=0; w<NUM_STRATEGIES; w++)
+    {
+        std::cout << boost::format("%-10s %-12s %10d %12.2f %12.1f %14.0f\n")
+                     % name
+                     % strategyName(w)
+                     % points.size()
+                     % construct
+                     % cost[w].ns
+                     % (cost[w].ns > 0 ? 1e9 / cost[w].ns : 0);
+    }
+}
+
+/*****************************************************************************/
+
+// Compare locate throughput of every walk over different kernels, on
+// identical inputs snapped to the integer grid.
+//
+//  --kernels        Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --queries        Number of walks per kernel, strategy and size.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+int runKernelBenchmark(const QStringList& args)
+{
+    QList<int>   sizes    = argIntList(args, "--n", "10000,100000,1000000");
+    QList<int>   dists    = argDistributions(args);
+    int          queries  = argValue(args, "--queries", "10000").toInt();
+    unsigned int seed     = argValue(args, "--seed",    "1"    ).toUInt();
+    int          dist     = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-10s %-12s %10s %12s %12s %14s\n")
+                 % "kernel" % "strategy" % "n"
+                 % "build ms" % "ns/query" % "queries/s";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        std::vector<Point> points;
+        generatePoints(dist, sizes[s], seed, points);
+        snapToGrid(points);
+
+        // Keep only query pairs inside the hull, decided once so that every
+        // kernel sees exactly the same queries.
+        Delaunay dt;
+        dt.insert(points.begin(), points.end());
+
+        std::vector<Point> candidates, pairs;
+        generatePoints(dist, 2*queries, seed + 1, candidates);
+        snapToGrid(candidates);
+
+        for (unsigned int i=0; i+1<candidates.size(); i+=2)
+        {
+            if (dt.is_infinite(dt.locate(candidates[i]  ))
+             || dt.is_infinite(dt.locate(candidates[i+1])))
+                continue;
+
+            pairs.push_back(candidates[i]);
+            pairs.push_back(candidates[i+1]);
+        }
+
+        benchmarkKernel<CGAL::Exact_predicates_inexact_constructions_kernel>
+                                            ("epick",    points, pairs);
+        benchmarkKernel<Filtered_double_kernel>
+                                            ("filtered", points, pairs);
+        benchmarkKernel<Integer_grid_kernel>
+                                            ("grid",     points, pairs);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+// Share of visibility walks that were restarted, and that fell back to a
+// straight walk, over the given queries.
+template <typename T>
+static void visibilityFailures(
+                T*                                          dt,
+                const std::vector<typename T::Point>&       targets,
+                const std::vector<typename T::Face_handle>& starts,
+                double&                                     restarted,
+                double&                                     fellBack)
+{
+    restarted = fellBack = 0;
+    for (unsigned int i=0; i<targets.size(); i++)
+    {
+        VisibilityWalk<T> w(targets[i], dt, starts[i], i);
+        restarted += w.getNumRestarts() > 0;
+        fellBack  += w.usedFallback();
+    }
+
+    if (!targets.empty())
+    {
+        restarted /= targets.size();
+        fellBack  /= targets.size();
+    }
+}
+
+/*****************************************************************************/
+
+template <typename T>
+static void meshRows(const char* name, T* dt, int dist, int queries,
+                     unsigned int seed)
+{
+    std::vector<typename T::Point>       targets;
+    std::vector<typename T::Face_handle> starts;
+    makeQueries(dt, dist, queries, seed, targets, starts);
+
+    WalkCost cost[NUM_STRATEGIES];
+    cost[STRAIGHT_WALK]   = measureWalks< StraightWalk<T>   >
+                                            (dt, targets, starts);
+    cost[VISIBILITY_WALK] = measureWalks< VisibilityWalk<T> >
+                                            (dt, targets, starts);
+    cost[PIVOT_WALK]      = measureWalks< PivotWalk<T>      >
+                                            (dt, targets, starts);
+
+    double restarted, fellBack;
+    visibilityFailures(dt, targets, starts, restarted, fellBack);
+
+    for (int w=0; w<NUM_STRATEGIES; w++)
+    {
+        bool visibility = w == VISIBILITY_WALK;
+
+        std::cout << boost::format("%-12s %-12s %10d %12.1f %12.2f %12.2f "
+                                   "%9s %9s\n")
+                     % name
+                     % strategyName(w)
+                     % dt->number_of_vertices()
+                     % cost[w].ns
+                     % cost[w].orientations
+                     % cost[w].triangles
+                     % (visibility ? QString::number(100*restarted, 'f', 1)
+                                         .toStdString() : "-")
+                     % (visibility ? QString::number(100*fellBack,  'f', 1)
+                                         .toStdString() : "-");
+    }
+}
+
+/*****************************************************************************/
+
+// Flip a share of the edges of t that can be flipped, leaving a valid
+// triangulation that is no longer Delaunay.
+static void randomFlips(Triangulation& t, double share, unsigned int seed)
+{
+    typedef Triangulation::Finite_edges_iterator    Edge_iterator;
+    typedef Triangulation::Edge                     Edge;
+
+    CGAL::Random      random(seed);
+    std::vector<Edge> edges;
+
+    for (Edge_iterator e=t.finite_edges_begin(); e!=t.finite_edges_end(); ++e)
+        if (random.get_double() < share)
+            edges.push_back(*e);
+
+    // Earlier flips reuse faces, so an edge may have moved by the time we
+    // reach it. Any flippable edge will do, so just test again.
+    for (unsigned int k=0; k<edges.size(); k++)
+    {
+        Face_handle f = edges[k].first;
+        int         i = edges[k].second;
+        Face_handle g = f->neighbor(i);
+
+        if (t.is_infinite(f) || t.is_infinite(g))
+            continue;
+
+        const Point& a = f->vertex(i)->point();
+        const Point& b = f->vertex(f->ccw(i))->point();
+        const Point& c = f->vertex(f->cw(i))->point();
+        const Point& d = t.mirror_vertex(f, i)->point();
+
+        // The new diagonal a-d must leave two counter-clockwise triangles.
+        if (CGAL::orientation(a, b, d) == CGAL::LEFT_TURN &&
+            CGAL::orientation(a, d, c) == CGAL::LEFT_TURN)
+            t.flip(f, i);
+    }
+}
+
+/*****************************************************************************/
+
+// Compare walks on Delaunay triangulations against the same points on
+// triangulations that are not Delaunay: a Delaunay triangulation with a
+// share of its edges flipped, and a plain incremental Triangulation_2.
+//
+//  --meshes         Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --flip           Share of the edges to try to flip.
+//  --queries        Number of walks per mesh and strategy.
+//  --seed           Seed for the pointsets, flips and queries.
+//  --distributions  Name of the point distribution (the first one is used).
+int runMeshBenchmark(const QStringList& args)
+{
+    QList<int>   sizes   = argIntList(args, "--n", "10000,100000");
+    QList<int>   dists   = argDistributions(args);
+    int          queries = argValue(args, "--queries", "1000").toInt();
+    unsigned int seed    = argValue(args, "--seed",    "1"   ).toUInt();
+    double       share   = argValue(args, "--flip",    "0.3" ).toDouble();
+    int          dist    = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-12s %-12s %10s %12s %12s %12s %9s %9s\n")
+                 % "mesh" % "strategy" % "n" % "ns/query" % "orient/query"
+                 % "tri/query" % "restart%" % "fallback%";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        std::vector<Point> points;
+        generatePoints(dist, sizes[s], seed, points);
+
+        Delaunay dt;
+        dt.insert(points.begin(), points.end());
+        meshRows("delaunay", &dt, dist, queries, seed);
+
+        // Delaunay and Triangulation share a data structure, so this copies
+        // the Delaunay faces into a triangulation that may be flipped.
+        Triangulation flipped(dt);
+        randomFlips(flipped, share, seed);
+        meshRows("flipped", &flipped, dist, queries, seed);
+
+        Triangulation plain;
+        plain.insert(points.begin(), points.end());
+        meshRows("incremental", &plain, dist, queries, seed);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,277 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Headless command-line tools for measuring the cost of the different walks.
+*
+* The helpers here are templated on the triangulation and walk types so that
+* each tool can time any strategy on any triangulation in the same way.
+*
+******************************************************************************/
+
+#ifndef BENCHMARK_H
+#define BENCHMARK_H
+
+/*****************************************************************************/
+
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include "mainwindow.h"
+#include "walk.h"
+#include "point_generators.h"
+
+/*****************************************************************************/
+
+enum WalkStrategy
+{
+    STRAIGHT_WALK = 0,
+    VISIBILITY_WALK,
+    PIVOT_WALK,
+    NUM_STRATEGIES
+};
+
+/*****************************************************************************/
+
+// Entry points for the headless modes. These return the process exit code.
+int                 runBenchmark(const QStringList& args);
+int                 runRecord(const QStringList& args);
+int                 runReplay(const QStringList& args);
+int                 runPerfCheck(const QStringList& args);
+int                 runKernelBenchmark(const QStringList& args);
+int                 runSeedingBenchmark(const QStringList& args);
+int                 runConstructionBenchmark(const QStringList& args);
+int                 runRender(const QStringList& args);
+int                 runSweep(const QStringList& args);
+int                 runMeshBenchmark(const QStringList& args);
+int                 runInterleaveBenchmark(const QStringList& args);
+int                 runSegmentBenchmark(const QStringList& args);
+int                 runNearestBenchmark(const QStringList& args);
+int                 runCompactBenchmark(const QStringList& args);
+int                 runCacheBenchmark(const QStringList& args);
+int                 runNumaBenchmark(const QStringList& args);
+int                 runStressTest(const QStringList& args);
+
+const char*         strategyName(int strategy);
+
+// Command-line helpers shared by the headless tools.
+QString             argValue(const QStringList& args,
+                             const QString&     name,
+                             const QString&     defaultValue = QString());
+QList<int>          argIntList(const QStringList& args,
+                               const QString&     name,
+                               const QString&     defaultValue);
+QList<int>          argDistributions(const QStringList& args);
+
+// Drop qDebug() output while timing, walks may write to it.
+void                silenceDebugOutput();
+
+/******************************************************************************
+* Average cost of a batch of walks.
+******************************************************************************/
+
+struct WalkCost
+{
+    double  ns;
+    double  orientations;
+    double  triangles;
+    double  cacheHits;
+
+    // Time spent finding the start faces, when they come from an oracle.
+    double  seedNs;
+
+    // Memory held by the trace of visited faces.
+    double  traceBytes;
+};
+
+/*****************************************************************************/
+
+// Build a triangulation of n points from the given distribution.
+template <typename T>
+void buildTriangulation(T* dt, int distribution, int n, unsigned int seed)
+{
+    std::vector<typename T::Point> points;
+    generatePoints(distribution, n, seed, points);
+
+    dt->clear();
+    dt->insert(points.begin(), points.end());
+}
+
+/*****************************************************************************/
+
+// Create a set of queries for dt. Targets are drawn from the same
+// distribution as the triangulation so that queries follow the data, and
+// each walk starts from the face containing another such point. Points that
+// fall outside the convex hull are rejected.
+template <typename T>
+void makeQueries(T*                                     dt,
+                 int                                    distribution,
+                 int                                    count,
+                 unsigned int                           seed,
+                 std::vector<typename T::Point>&        targets,
+                 std::vector<typename T::Face_handle>&  starts)
+{
+    typedef typename T::Point       Point;
+    typedef typename T::Face_handle Face_handle;
+
+    targets.clear();
+    starts.clear();
+
+    std::vector<Point> candidates;
+
+    // Keep drawing until we have enough, but give up on pathological sets
+    // (such as points on a circle) where almost nothing is inside the hull.
+    for (int round=0; (int)targets.size() < count && round < 16; round++)
+    {
+        generatePoints(distribution, 2*count, seed + 7919*(round+1), candidates);
+
+        for (int i=0; i+1 < (int)candidates.size(); i+=2)
+        {
+            Face_handle s = dt->locate(candidates[i]);
+            Face_handle t = dt->locate(candidates[i+1]);
+
+            if (dt->is_infinite(s) || dt->is_infinite(t))
+                continue;
+
+            starts.push_back(s);
+            targets.push_back(candidates[i+1]);
+
+            if ((int)targets.size() == count)
+                break;
+        }
+    }
+}
+
+/*****************************************************************************/
+
+// Time walks of type W over the given queries.
+template <typename W, typename T>
+WalkCost measureWalks(T*                                            dt,
+                      const std::vector<typename T::Point>&         targets,
+                      const std::vector<typename T::Face_handle>&   starts)
+{
+    WalkCost cost = {0, 0, 0, 0, 0, 0};
+    if (targets.empty())
+        return cost;
+
+    long long orientations = 0;
+    long long triangles    = 0;
+    long long hits         = 0;
+    long long bytes        = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (unsigned int i=0; i<targets.size(); i++)
+    {
+        W w(targets[i], dt, starts[i], i);
+        orientations += w.getNumOrientationsPerformed();
+        triangles    += w.getNumTrianglesVisited();
+        hits         += w.getNumOrientationCacheHits();
+        bytes        += w.getTrace().bytes();
+    }
+
+    cost.ns           = timer.nsecsElapsed() / (double)targets.size();
+    cost.orientations = orientations         / (double)targets.size();
+    cost.triangles    = triangles            / (double)targets.size();
+    cost.cacheHits    = hits                 / (double)targets.size();
+    cost.traceBytes   = bytes                / (double)targets.size();
+
+    return cost;
+}
+
+/*****************************************************************************/
+
+// Time walks of type W started from faces given by an oracle. The time
+// spent asking the oracle is reported separately from the walks.
+template <typename W, typename T>
+WalkCost measureSeededWalks(T*                                      dt,
+                            StartFaceOracle<T>&                     oracle,
+                            const std::vector<typename T::Point>&   targets)
+{
+    std::vector<typename T::Face_handle> starts(targets.size());
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (unsigned int i=0; i<targets.size(); i++)
+        starts[i] = oracle.startFace(targets[i]);
+
+    qint64 ns = timer.nsecsElapsed();
+
+    WalkCost cost = measureWalks<W>(dt, targets, starts);
+    cost.seedNs   = targets.empty() ? 0 : ns / (double)targets.size();
+    return cost;
+}
+
+/*****************************************************************************/
+
+// Totals of the pivot statistics over a batch of pivot walks. completed is
+// true only if every walk completed.
+template <typename T>
+PivotStatistics pivotStatistics(
+                    T*                                          dt,
+                    const std::vector<typename T::Point>&       targets,
+                    const std::vector<typename T::Face_handle>& starts)
+{
+    PivotStatistics total = {0, 0, 0, 0, 0, true};
+
+    for (unsigned int i=0; i<targets.size(); i++)
+    {
+        PivotWalk<T> w(targets[i], dt, starts[i], i);
+        const PivotStatistics& s = w.getStatistics();
+
+        total.pivots    += s.pivots;
+        total.triangles += s.triangles;
+        total.saved     += s.saved;
+        total.lost      += s.lost;
+        total.steps     += s.steps;
+        total.completed  = total.completed && s.completed;
+    }
+
+    return total;
+}
+
+/*****************************************************************************/
+
+template <typename W, typename T>
+int runWalkOf(const typename T::Point&          p,
+              T*                                dt,
+              typename T::Face_handle           f,
+              unsigned int                      seed,
+              QList<typename T::Face_handle>&   faces)
+{
+    W w(p, dt, f, seed);
+    faces = w.getFaces();
+    return w.getNumOrientationsPerformed();
+}
+
+/*****************************************************************************/
+
+// Run a single walk of the given strategy, keeping the faces it visited.
+// Returns the number of orientations performed.
+template <typename T>
+int runWalk(int                             strategy,
+            const typename T::Point&        p,
+            T*                              dt,
+            typename T::Face_handle         f,
+            unsigned int                    seed,
+            QList<typename T::Face_handle>& faces)
+{
+    switch (strategy)
+    {
+        case STRAIGHT_WALK:
+            return runWalkOf< StraightWalk<T>   >(p, dt, f, seed, faces);
+        case VISIBILITY_WALK:
+            return runWalkOf< VisibilityWalk<T> >(p, dt, f, seed, faces);
+        case PIVOT_WALK:
+        default:
+            return runWalkOf< PivotWalk<T>      >(p, dt, f, seed, faces);
+    }
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
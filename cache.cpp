@@ -0,0 +1,244 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Walks seeded from a shared cache of recent end faces, on query streams
+* with locality.
+******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <boost/format.hpp>
+
+#include <QThreadPool>
+
+#include "benchmark.h"
+#include "grid_index.h"
+#include "startface_cache.h"
+
+/*****************************************************************************/
+
+// Queries from a number of streams, each one a random walk inside the
+// convex hull taking steps of the given length. Stream s is the queries
+// from s*length up to (s+1)*length.
+static void makeStreams(Delaunay*           dt,
+                        int                 distribution,
+                        int                 streams,
+                        int                 length,
+                        double              step,
+                        unsigned int        seed,
+                        std::vector<Point>& queries)
+{
+    CGAL::Random       random(seed);
+    std::vector<Point> starts;
+    generatePoints(distribution, 4*streams, seed, starts);
+
+    queries.clear();
+    for (unsigned int i=0; i<starts.size() && (int)queries.size() <
+                                              streams*length; i++)
+    {
+        Face_handle f = dt->locate(starts[i]);
+        if (dt->is_infinite(f))
+            continue;
+
+        Point p = starts[i];
+        queries.push_back(p);
+
+        for (int k=1, tries=0; k<length; tries++)
+        {
+            double angle = random.get_double(0, 2*M_PI);
+            Point  q(p.x() + step * std::cos(angle),
+                     p.y() + step * std::sin(angle));
+
+            // Stay put rather than leave the hull.
+            Face_handle g = dt->locate(q, f);
+            if (!dt->is_infinite(g) || tries > 64)
+            {
+                if (!dt->is_infinite(g))
+                {
+                    p = q;
+                    f = g;
+                }
+                queries.push_back(p);
+                tries = 0;
+                k++;
+            }
+        }
+    }
+}
+
+/*****************************************************************************/
+
+// Counts the hits of one thread on the shared cache, so that threads do not
+// contend for a counter.
+struct CountingOracle : public StartFaceOracle<Delaunay>
+{
+    StartFaceCache<Delaunay>*       cache;
+    StartFaceOracle<Delaunay>*      fallback;
+    long long                       hits;
+
+    Face_handle startFace(const Point& p)
+    {
+        Face_handle f;
+        if (cache->lookup(p, f))
+        {
+            hits++;
+            return f;
+        }
+        return fallback->startFace(p);
+    }
+
+    void walkEnded(const Point& p, Face_handle f)
+    {
+        cache->record(p, f);
+    }
+};
+
+/*****************************************************************************/
+
+// Walks one stream per chunk, seeded from the grid, or from the cache with
+// the grid behind it.
+struct StreamWalker
+{
+    Delaunay*                       dt;
+    GridIndex<Delaunay>*            grid;
+    StartFaceCache<Delaunay>*       cache;      // Null to use the grid only.
+    const Point*                    queries;
+    long long*                      orientations;
+    long long*                      hits;
+
+    void operator()(int chunk, int begin, int end)
+    {
+        CountingOracle counting;
+        counting.cache    = cache;
+        counting.fallback = grid;
+        counting.hits     = 0;
+
+        StartFaceOracle<Delaunay>* oracle = cache
+                                          ? (StartFaceOracle<Delaunay>*)&counting
+                                          : grid;
+
+        long long o = 0;
+        for (int i=begin; i<end; i++)
+        {
+            VisibilityWalk<Delaunay> w(queries[i], dt, oracle, i);
+            o += w.getNumOrientationsPerformed();
+        }
+
+        orientations[chunk] = o;
+        hits[chunk]         = counting.hits;
+    }
+};
+
+/*****************************************************************************/
+
+// Walk every stream, concurrently, and print the cost per query. Returns
+// the orientations per query.
+static double streamRow(const char*               method,
+                        Delaunay*                 dt,
+                        GridIndex<Delaunay>*      grid,
+                        StartFaceCache<Delaunay>* cache,
+                        const std::vector<Point>& queries,
+                        int                       length,
+                        int                       threads,
+                        double                    baseline)
+{
+    int chunks = (queries.size() + length - 1) / length;
+    std::vector<long long> orientations(chunks, 0), hits(chunks, 0);
+
+    StreamWalker walker;
+    walker.dt           = dt;
+    walker.grid         = grid;
+    walker.cache        = cache;
+    walker.queries      = &queries[0];
+    walker.orientations = &orientations[0];
+    walker.hits         = &hits[0];
+
+    QThreadPool::globalInstance()->setMaxThreadCount(threads);
+
+    QElapsedTimer timer;
+    timer.start();
+    parallelChunks(queries.size(), length, walker);
+    double ns = timer.nsecsElapsed();
+
+    long long o = 0, h = 0;
+    for (int c=0; c<chunks; c++)
+    {
+        o += orientations[c];
+        h += hits[c];
+    }
+
+    double q      = queries.size();
+    double orient = o / q;
+
+    std::cout << boost::format("%-8s %10d %8d %10.1f %10.2f %8.1f %10.2f\n")
+                 % method % dt->number_of_vertices() % threads % (ns / q)
+                 % orient % (100.0 * h / q)
+                 % (baseline > 0 ? baseline - orient : 0.0);
+
+    return orient;
+}
+
+/*****************************************************************************/
+
+// Compare walks seeded from a grid index with walks seeded from the start
+// face cache, falling back to the grid, on streams of queries that each
+// move a short distance at a time. Streams run concurrently and share one
+// cache.
+//
+//  --cache          Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --streams        Number of query streams.
+//  --queries        Number of queries in each stream.
+//  --step           Distance between consecutive queries of a stream, as a
+//                   fraction of the radius of the point distribution.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+int runCacheBenchmark(const QStringList& args)
+{
+    QList<int>   sizes   = argIntList(args, "--n", "100000,1000000");
+    QList<int>   dists   = argDistributions(args);
+    int          streams = argValue(args, "--streams", "64"   ).toInt();
+    int          length  = argValue(args, "--queries", "10000").toInt();
+    double       step    = argValue(args, "--step",    "0.002").toDouble();
+    unsigned int seed    = argValue(args, "--seed",    "1"    ).toUInt();
+    int          dist    = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+    int          cores   = QThread::idealThreadCount();
+
+    length = qMax(1, length);
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-8s %10s %8s %10s %10s %8s %10s\n")
+                 % "seeding" % "n" % "threads" % "ns/query" % "orient"
+                 % "hit %" % "saved";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        Delaunay dt;
+        buildTriangulation(&dt, dist, sizes[s], seed);
+
+        std::vector<Point> queries;
+        makeStreams(&dt, dist, streams, length, step * GENERATOR_RADIUS,
+                    seed, queries);
+        if (queries.empty())
+            continue;
+
+        GridIndex<Delaunay> grid(&dt);
+
+        int threads[2] = { 1, cores };
+        for (int t=0; t<2; t++)
+        {
+            double base = streamRow("grid", &dt, &grid, 0, queries, length,
+                                    threads[t], 0);
+
+            StartFaceCache<Delaunay> cache(&dt, &grid);
+            streamRow("cache", &dt, &grid, &cache, queries, length,
+                      threads[t], base);
+        }
+
+        QThreadPool::globalInstance()->setMaxThreadCount(cores);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,123 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Walks on compact float32 and int32 mirrors against walks on the doubles.
+******************************************************************************/
+
+#include <iostream>
+#include <boost/format.hpp>
+
+#include "benchmark.h"
+#include "compact_triangulation.h"
+
+/*****************************************************************************/
+
+static void printRow(const char*                path,
+                     int                        n,
+                     double                     ns,
+                     double                     mb,
+                     const CompactWalkCounters& c,
+                     int                        queries,
+                     const char*                same)
+{
+    double q = qMax(1, queries);
+
+    std::cout << boost::format("%-10s %10d %10.1f %9.2f %9.2f %10.4f "
+                               "%11.1f %8.1f %6s\n")
+                 % path % n % (ns / q) % (c.faces / q) % (c.orientations / q)
+                 % (100.0 * c.escalations / qMax(1LL, c.orientations))
+                 % (c.bytes / q) % mb % same;
+}
+
+/*****************************************************************************/
+
+// Walk every query on a mirror with coordinates stored as C, and check that
+// each walk ends in the face the walk on the doubles ended in.
+template <typename C>
+static void compactRow(Delaunay*                       dt,
+                       const std::vector<Point>&       targets,
+                       const std::vector<Face_handle>& starts,
+                       const std::vector<Face_handle>& reference)
+{
+    CompactTriangulation<Delaunay, C> compact(dt);
+
+    std::vector<int> from(starts.size()), to(starts.size());
+    for (unsigned int i=0; i<starts.size(); i++)
+        from[i] = compact.indexOf(starts[i]);
+
+    CompactWalkCounters counters = {0, 0, 0, 0};
+
+    QElapsedTimer timer;
+    timer.start();
+    for (unsigned int i=0; i<targets.size(); i++)
+        to[i] = compact.locate(targets[i], from[i], i, counters);
+    double ns = timer.nsecsElapsed();
+
+    bool same = true;
+    for (unsigned int i=0; i<targets.size() && same; i++)
+        same = compact.face(to[i]) == reference[i];
+
+    printRow(C::name(), dt->number_of_vertices(), ns,
+             compact.bytes() / 1e6, counters, targets.size(),
+             same ? "yes" : "no");
+}
+
+/*****************************************************************************/
+
+// Time the same visibility walks on the triangulation and on compact
+// mirrors of it, with the bytes of triangulation read by each.
+//
+//  --compact        Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --queries        Number of walks per path and size.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+//
+// The memory column is the size of the mirror, or for the doubles an
+// estimate from the sizes of the face and vertex records.
+int runCompactBenchmark(const QStringList& args)
+{
+    QList<int>   sizes   = argIntList(args, "--n", "100000,1000000,4000000");
+    QList<int>   dists   = argDistributions(args);
+    int          queries = argValue(args, "--queries", "100000").toInt();
+    unsigned int seed    = argValue(args, "--seed",    "1"     ).toUInt();
+    int          dist    = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-10s %10s %10s %9s %9s %10s %11s %8s %6s\n")
+                 % "path" % "n" % "ns/query" % "faces" % "orient"
+                 % "escalate %" % "bytes/query" % "MB" % "same";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        Delaunay dt;
+        buildTriangulation(&dt, dist, sizes[s], seed);
+
+        std::vector<Point>       targets;
+        std::vector<Face_handle> starts;
+        makeQueries(&dt, dist, queries, seed, targets, starts);
+
+        // The walk on the doubles, which the mirrors must agree with.
+        std::vector<Face_handle> reference(targets.size());
+        CompactWalkCounters      counters = {0, 0, 0, 0};
+
+        QElapsedTimer timer;
+        timer.start();
+        for (unsigned int i=0; i<targets.size(); i++)
+            reference[i] = visibilityLocate(&dt, targets[i], starts[i], i,
+                                            counters);
+        double ns = timer.nsecsElapsed();
+
+        double mb = (dt.number_of_faces()    * sizeof(Delaunay::Face)
+                   + dt.number_of_vertices() * sizeof(Delaunay::Vertex))
+                  / 1e6;
+        printRow("double", sizes[s], ns, mb, counters, targets.size(), "-");
+
+        compactRow<FloatCoordinates>(&dt, targets, starts, reference);
+        compactRow<FixedCoordinates>(&dt, targets, starts, reference);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,169 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Compact record of the faces visited by a walk.
+*
+* Consecutive faces of a walk are almost always neighbours, so after the
+* first face each step is stored as the 2-bit index of the neighbour that
+* was crossed into, four steps to a byte. The fourth code is an escape,
+* followed by a second code saying whether the step revisits the same face
+* (as the pivot walk does when it changes pivot) or jumps to a face that is
+* not adjacent, which is then kept in full in a side list.
+*
+******************************************************************************/
+
+#ifndef COMPACT_TRACE_H
+#define COMPACT_TRACE_H
+
+/*****************************************************************************/
+
+#include <vector>
+#include <algorithm>
+
+/*****************************************************************************/
+
+template <typename T>
+class CompactTrace
+{
+    typedef typename T::Face_handle                     Face_handle;
+
+    enum { ESCAPE = 3, REPEAT = 0, JUMP = 1 };
+
+public:
+    /*************************************************************************/
+
+    // Decodes the trace one face at a time.
+    class const_iterator
+    {
+    public:
+        const_iterator(const CompactTrace* trace, int step)
+            : trace(trace), step(step), code(0), jump(0)
+        {
+            if (step < trace->size())
+                face = trace->start;
+        }
+
+        Face_handle operator*()  const { return face; }
+
+        bool operator==(const const_iterator& o) const { return step==o.step; }
+        bool operator!=(const const_iterator& o) const { return step!=o.step; }
+
+        const_iterator& operator++()
+        {
+            if (++step >= trace->size())
+                return *this;
+
+            int c = trace->code(code++);
+            if (c != ESCAPE)
+                face = face->neighbor(c);
+            else if (trace->code(code++) == JUMP)
+                face = trace->jumps[jump++];
+
+            return *this;
+        }
+
+    private:
+        const CompactTrace*         trace;
+        int                         step;
+        int                         code;
+        int                         jump;
+        Face_handle                 face;
+    };
+
+    /*************************************************************************/
+
+    CompactTrace() : steps(0), codes(0) {}
+
+    // Add the next face of the walk.
+    void append(Face_handle f)
+    {
+        if (steps++ == 0)
+        {
+            start = last = f;
+            return;
+        }
+
+        if (f == last)
+        {
+            push(ESCAPE);
+            push(REPEAT);
+            return;
+        }
+
+        for (int i=0; i<3; i++)
+        {
+            if (last->neighbor(i) == f)
+            {
+                push(i);
+                last = f;
+                return;
+            }
+        }
+
+        push(ESCAPE);
+        push(JUMP);
+        jumps.push_back(f);
+        last = f;
+    }
+
+    void clear()
+    {
+        steps = codes = 0;
+        packed.clear();
+        jumps.clear();
+    }
+
+    // Number of faces in the trace, counting repeats.
+    int size() const { return steps; }
+
+    // The last face added, without decoding the trace.
+    Face_handle back() const { return last; }
+
+    const_iterator begin() const { return const_iterator(this, 0);     }
+    const_iterator end()   const { return const_iterator(this, steps); }
+
+    // Number of different faces in the trace.
+    int distinctFaces() const
+    {
+        std::vector<const void*> seen;
+        seen.reserve(steps);
+        for (const_iterator i=begin(); i!=end(); ++i)
+            seen.push_back(&**i);
+
+        std::sort(seen.begin(), seen.end());
+        return std::unique(seen.begin(), seen.end()) - seen.begin();
+    }
+
+    // Heap and object memory used by this trace.
+    size_t bytes() const
+    {
+        return sizeof(*this) + packed.capacity()
+                             + jumps.capacity() * sizeof(Face_handle);
+    }
+
+private:
+    int code(int i) const
+    {
+        return (packed[i >> 2] >> ((i & 3) * 2)) & 3;
+    }
+
+    void push(int c)
+    {
+        if ((codes & 3) == 0)
+            packed.push_back(0);
+        packed.back() |= c << ((codes & 3) * 2);
+        codes++;
+    }
+
+    Face_handle                     start;
+    Face_handle                     last;
+    int                             steps;
+    int                             codes;
+    std::vector<unsigned char>      packed;
+    std::vector<Face_handle>        jumps;
+};
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,383 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* A compact copy of a triangulation for walking with less memory traffic.
+*
+* A step of a walk on the triangulation reads a face and then, through a
+* pointer for each vertex, two doubles per point. The mirror keeps instead
+* one array of faces holding vertex and neighbour indices, and one array of
+* coordinates by vertex index, stored as float32 or as int32 on a grid.
+*
+* Orientations on the stored coordinates are filtered. Every stored
+* coordinate is within delta of the true one, and the filter bounds both
+* that error and the rounding error of evaluating the determinant. If the
+* determinant is larger than the bound, its sign is the sign of the exact
+* orientation of the original points. Otherwise the original points are
+* fetched and the orientation is done by the triangulation's kernel.
+*
+******************************************************************************/
+
+#ifndef COMPACT_TRIANGULATION_H
+#define COMPACT_TRIANGULATION_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+#include <CGAL/Unique_hash_map.h>
+
+#include "trace.h"
+
+/*****************************************************************************/
+
+// Work done by walks, summed over a batch. Bytes are the sizes of the
+// records read from the triangulation, counted every time they are read.
+struct CompactWalkCounters
+{
+    long long   faces;
+    long long   orientations;
+    long long   escalations;        // Orientations the filter left undecided.
+    long long   bytes;
+};
+
+/******************************************************************************
+* Ways of storing coordinates. load(store(x)) is always within delta of x,
+* for x in the range given to setRange().
+******************************************************************************/
+
+// Rounded to the nearest float, so delta is relative to the largest
+// magnitude.
+struct FloatCoordinates
+{
+    typedef float                                       Coord;
+
+    double                          delta;
+
+    static const char* name() { return "float32"; }
+
+    void setRange(double lo, double hi)
+    {
+        double m = std::max(std::fabs(lo), std::fabs(hi));
+        delta    = m * std::ldexp(1., -24)
+                 + std::numeric_limits<float>::denorm_min();
+    }
+
+    Coord  store(double x) const { return (float)x;  }
+    double load(Coord c)   const { return c;         }
+};
+
+/*****************************************************************************/
+
+// Rounded to a grid of 2^31 steps across the range. The step is a power of
+// two, so scaling is exact and only the shifts by the origin round.
+struct FixedCoordinates
+{
+    typedef qint32                                      Coord;
+
+    double                          origin;
+    double                          step;
+    double                          delta;
+
+    static const char* name() { return "int32"; }
+
+    void setRange(double lo, double hi)
+    {
+        int e;
+        std::frexp(std::max((hi - lo) / 2, 1e-300), &e);
+
+        origin = (lo + hi) / 2;
+        step   = std::ldexp(1., e - 30);
+
+        double m = std::max(std::fabs(lo), std::fabs(hi)) + std::fabs(origin);
+        delta    = step / 2 + 4 * m * std::ldexp(1., -53);
+    }
+
+    Coord  store(double x) const
+    {
+        return (Coord)std::floor((x - origin) / step + 0.5);
+    }
+
+    double load(Coord c)   const { return origin + c * step; }
+};
+
+/*****************************************************************************/
+
+template <typename T, typename C = FloatCoordinates>
+class CompactTriangulation
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+    typedef typename T::All_vertices_iterator           All_vertices_iterator;
+    typedef typename C::Coord                           Coord;
+
+    struct Face
+    {
+        qint32                      vertex[3];
+        qint32                      neighbor[3];
+    };
+
+    struct Vertex
+    {
+        Coord                       x;
+        Coord                       y;
+    };
+
+public:
+    CompactTriangulation(T* dt) : dt(dt), faceIds(dt)
+    {
+        CGAL::Unique_hash_map<Vertex_handle, qint32> vertexIds;
+
+        double lo =  std::numeric_limits<double>::max();
+        double hi = -std::numeric_limits<double>::max();
+
+        All_vertices_iterator v;
+        for (v = dt->all_vertices_begin(); v != dt->all_vertices_end(); ++v)
+        {
+            vertexIds[v] = handles.size();
+            handles.push_back(v);
+
+            if (dt->is_infinite(v))
+                continue;
+
+            lo = std::min(lo, std::min(v->point().x(), v->point().y()));
+            hi = std::max(hi, std::max(v->point().x(), v->point().y()));
+        }
+
+        // No finite vertices, only the infinite one.
+        if (lo > hi)
+            lo = hi = 0;
+
+        coords.setRange(lo, hi);
+
+        vertices.resize(handles.size());
+        for (unsigned int i=0; i<handles.size(); i++)
+        {
+            // The infinite vertex is never read, but must be stored like
+            // any other, so give it a point of the range.
+            Point p = dt->is_infinite(handles[i]) ? Point(lo, lo)
+                                                  : handles[i]->point();
+            vertices[i].x = coords.store(p.x());
+            vertices[i].y = coords.store(p.y());
+        }
+
+        infinite = vertexIds[dt->infinite_vertex()];
+
+        faces.resize(faceIds.size());
+        for (quint32 i=0; i<faceIds.size(); i++)
+        {
+            Face_handle f = faceIds.face(i);
+            for (int j=0; j<3; j++)
+            {
+                faces[i].vertex[j]   = vertexIds[f->vertex(j)];
+                faces[i].neighbor[j] = faceIds.id(f->neighbor(j));
+            }
+        }
+    }
+
+    /*************************************************************************/
+
+    // Convert between faces of the triangulation and of the mirror.
+    int         indexOf(Face_handle f)   { return faceIds.id(f);   }
+    Face_handle face(int i)        const { return faceIds.face(i); }
+
+    // Memory used by the face and coordinate arrays.
+    size_t bytes() const { return faceBytes() + vertexBytes(); }
+
+    // Where the two arrays are, for checking which memory holds them.
+    size_t faceBytes()   const { return faces.size()    * sizeof(Face);   }
+    size_t vertexBytes() const { return vertices.size() * sizeof(Vertex); }
+
+    const void* faceArray() const
+    {
+        return faces.empty() ? 0 : &faces[0];
+    }
+
+    const void* vertexArray() const
+    {
+        return vertices.empty() ? 0 : &vertices[0];
+    }
+
+    /*************************************************************************/
+
+    // Visibility walk from face f towards p. Makes the same random choices
+    // as visibilityLocate() below with the same seed, and as the filter only
+    // answers when it is certain, ends in the same face. Stops on leaving
+    // the convex hull. The triangulation must be Delaunay, so that the walk
+    // cannot cycle.
+    int locate(const Point& p, int f, unsigned int seed,
+               CompactWalkCounters& counters) const
+    {
+        unsigned int random = seed * 2654435761u | 1;
+        int          prev   = -1;
+
+        // Step off an infinite face.
+        if (isInfinite(f))
+            f = faces[f].neighbor[indexOfInfinite(f)];
+
+        for (;;)
+        {
+            const Face& c = faces[f];
+            counters.faces++;
+            counters.bytes += sizeof(Face);
+
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+
+            int next = -1;
+            for (int k=0; k<3 && next < 0; k++)
+            {
+                int i = (random + k) % 3;
+                if (c.neighbor[i] == prev)
+                    continue;
+
+                if (orientation(c.vertex[(i+1)%3], c.vertex[(i+2)%3], p,
+                                counters) == CGAL::RIGHT_TURN)
+                    next = c.neighbor[i];
+            }
+
+            if (next < 0 || isInfinite(next))
+                return next < 0 ? f : next;
+
+            prev = f;
+            f    = next;
+        }
+    }
+
+private:
+    /*************************************************************************/
+
+    bool isInfinite(int f) const
+    {
+        const Face& c = faces[f];
+        return c.vertex[0] == infinite || c.vertex[1] == infinite
+                                       || c.vertex[2] == infinite;
+    }
+
+    int indexOfInfinite(int f) const
+    {
+        const Face& c = faces[f];
+        return c.vertex[0] == infinite ? 0 : c.vertex[1] == infinite ? 1 : 2;
+    }
+
+    /*************************************************************************/
+
+    // Orientation of (a, b, p) for vertices a and b, decided on the stored
+    // coordinates when the error bound allows.
+    //
+    // Write a' and b' for the stored points, each coordinate within delta
+    // of the true one, and let dx1 = b'x - a'x, dy1 = b'y - a'y,
+    // dx2 = px - a'x and dy2 = py - a'y. Moving the points back changes
+    // dx1, dy1 by at most 2 delta and dx2, dy2 by at most delta, so the
+    // determinant dx1 dy2 - dy1 dx2 changes by at most
+    //
+    //     delta (|dx1| + |dy1|) + 2 delta (|dx2| + |dy2|) + 4 delta^2.
+    //
+    // Evaluating it in doubles adds at most ORIENT_ERROR (|dx1 dy2| +
+    // |dy1 dx2|), Shewchuk's bound for the orientation determinant. Both
+    // terms are widened a little for the rounding in computing them.
+    CGAL::Orientation orientation(int a, int b, const Point& p,
+                                  CompactWalkCounters& counters) const
+    {
+        static const double eps          = std::ldexp(1., -53);
+        static const double ORIENT_ERROR = (3 + 16*eps) * eps;
+
+        counters.orientations++;
+        counters.bytes += 2 * sizeof(Vertex);
+
+        double ax  = coords.load(vertices[a].x);
+        double ay  = coords.load(vertices[a].y);
+        double dx1 = coords.load(vertices[b].x) - ax;
+        double dy1 = coords.load(vertices[b].y) - ay;
+        double dx2 = p.x() - ax;
+        double dy2 = p.y() - ay;
+
+        double left  = dx1 * dy2;
+        double right = dy1 * dx2;
+        double det   = left - right;
+
+        double d     = coords.delta;
+        double bound = ORIENT_ERROR * (std::fabs(left) + std::fabs(right))
+                     + (d * (std::fabs(dx1) + std::fabs(dy1))
+                        + 2 * d * (std::fabs(dx2) + std::fabs(dy2))
+                        + 4 * d * d) * (1 + 8*eps);
+
+        if (det >  bound) return CGAL::LEFT_TURN;
+        if (det < -bound) return CGAL::RIGHT_TURN;
+
+        counters.escalations++;
+        counters.bytes += 2 * sizeof(typename T::Vertex);
+        return dt->orientation(handles[a]->point(), handles[b]->point(), p);
+    }
+
+    /*************************************************************************/
+
+    T*                              dt;
+    FaceIndex<T>                    faceIds;
+    C                               coords;
+    qint32                          infinite;
+    std::vector<Face>               faces;
+    std::vector<Vertex>             vertices;
+    std::vector<Vertex_handle>      handles;
+};
+
+/*****************************************************************************/
+
+// The same walk as CompactTriangulation::locate(), on the triangulation
+// itself with its own points, to compare against.
+template <typename T>
+typename T::Face_handle visibilityLocate(T*                          dt,
+                                         const typename T::Point&    p,
+                                         typename T::Face_handle     f,
+                                         unsigned int                seed,
+                                         CompactWalkCounters&        counters)
+{
+    typedef typename T::Face_handle Face_handle;
+
+    unsigned int random = seed * 2654435761u | 1;
+    Face_handle  prev;
+
+    if (dt->is_infinite(f))
+        f = f->neighbor(f->index(dt->infinite_vertex()));
+
+    for (;;)
+    {
+        counters.faces++;
+        counters.bytes += sizeof(typename T::Face);
+
+        random ^= random << 13;
+        random ^= random >> 17;
+        random ^= random << 5;
+
+        Face_handle next;
+        for (int k=0; k<3 && next == Face_handle(); k++)
+        {
+            int i = (random + k) % 3;
+            if (f->neighbor(i) == prev)
+                continue;
+
+            counters.orientations++;
+            counters.bytes += 2 * sizeof(typename T::Vertex);
+
+            if (dt->orientation(f->vertex((i+1)%3)->point(),
+                                f->vertex((i+2)%3)->point(), p)
+                                                        == CGAL::RIGHT_TURN)
+                next = f->neighbor(i);
+        }
+
+        if (next == Face_handle() || dt->is_infinite(next))
+            return next == Face_handle() ? f : next;
+
+        prev = f;
+        f    = next;
+    }
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,171 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Offscreen buffer of face IDs used to pick the face under the cursor.
+*
+* Every finite face is painted into an image at the resolution of the view,
+* filled with a colour that encodes its index. Picking the face under a
+* point is then a single pixel read. Rasterisation is only exact away from
+* edges, so the face read from the buffer is checked against the point with
+* three orientation tests, and if the point is not inside it we walk from
+* there. The walk is almost always one or two triangles long.
+*
+******************************************************************************/
+
+#ifndef FACEID_BUFFER_H
+#define FACEID_BUFFER_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <vector>
+
+#include <QImage>
+#include <QPainter>
+#include <QPolygonF>
+#include <QTransform>
+
+#include "walk.h"
+
+/*****************************************************************************/
+
+// Pixels of the buffer that are not covered by any face.
+const QRgb FACEID_NONE      = 0;
+
+// Faces are numbered from 1 in the 24 bits of colour.
+const int  FACEID_MAX_FACES = 0xFFFFFF;
+
+/*****************************************************************************/
+
+template <typename T>
+class FaceIdBuffer
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Finite_faces_iterator           Finite_faces_iterator;
+
+public:
+    FaceIdBuffer() : dt(0), numHits(0), numWalks(0) {}
+
+    // Forget the current contents, after the triangulation has changed.
+    void invalidate()
+    {
+        dt = 0;
+        faces.clear();
+        image = QImage();
+    }
+
+    // True if the buffer was built for this triangulation and view.
+    bool isCurrent(const T*          t,
+                   const QTransform& transform,
+                   const QSize&      size) const
+    {
+        return dt == t && transform == sceneToImage && size == image.size();
+    }
+
+    // Paint every finite face of t through the given scene to viewport
+    // transform. Triangulations with more faces than the colours can number
+    // are not buffered, and locate() always walks.
+    void rebuild(T* t, const QTransform& transform, const QSize& size)
+    {
+        invalidate();
+
+        dt           = t;
+        sceneToImage = transform;
+        image        = QImage(size, QImage::Format_RGB32);
+        image.fill(FACEID_NONE);
+
+        if (t->number_of_vertices() * 2 > (unsigned)FACEID_MAX_FACES)
+            return;
+
+        faces.push_back(Face_handle());
+
+        // No antialiasing and no outline: blending would invent IDs.
+        QPainter painter(&image);
+        painter.setRenderHint(QPainter::Antialiasing, false);
+        painter.setPen(Qt::NoPen);
+        painter.setTransform(transform);
+
+        QPolygonF triangle(3);
+        Finite_faces_iterator it;
+        for (it = t->finite_faces_begin(); it != t->finite_faces_end(); it++)
+        {
+            for (int i=0; i<3; i++)
+            {
+                const Point& p = it->vertex(i)->point();
+                triangle[i]    = QPointF(p.x(), p.y());
+            }
+
+            painter.setBrush(QColor(QRgb(faces.size())));
+            painter.drawPolygon(triangle);
+            faces.push_back(it);
+        }
+    }
+
+    // The face painted under p, or a null handle if p is outside the view
+    // or not covered by a finite face.
+    Face_handle faceAt(const Point& p) const
+    {
+        if (faces.empty())
+            return Face_handle();
+
+        QPointF q = sceneToImage.map(QPointF(p.x(), p.y()));
+        int     x = (int)std::floor(q.x());
+        int     y = (int)std::floor(q.y());
+
+        if (x < 0 || y < 0 || x >= image.width() || y >= image.height())
+            return Face_handle();
+
+        const QRgb* line = reinterpret_cast<const QRgb*>(image.scanLine(y));
+        unsigned    id   = line[x] & FACEID_MAX_FACES;
+
+        return id < faces.size() ? faces[id] : Face_handle();
+    }
+
+    // Locate p exactly, starting from the face in the buffer when there is
+    // one and from the oracle, if given, otherwise.
+    Face_handle locate(const Point& p, StartFaceOracle<T>* oracle=0)
+    {
+        Face_handle f = faceAt(p);
+
+        if (f != Face_handle() && contains(f, p))
+        {
+            numHits++;
+            return f;
+        }
+
+        numWalks++;
+        if (f == Face_handle() && oracle)
+            f = oracle->startFace(p);
+
+        return dt->locate(p, f);
+    }
+
+    // Number of locates answered by the buffer alone, and by walking.
+    int getNumHits()  const { return numHits;  }
+    int getNumWalks() const { return numWalks; }
+
+private:
+    // Points on an edge of f count as inside it.
+    bool contains(Face_handle f, const Point& p) const
+    {
+        for (int i=0; i<3; i++)
+            if (dt->orientation(f->vertex(f->ccw(i))->point(),
+                                f->vertex(f->cw(i))->point(),
+                                p) == CGAL::RIGHT_TURN)
+                return false;
+        return true;
+    }
+
+    T*                              dt;
+    QTransform                      sceneToImage;
+    QImage                          image;
+    std::vector<Face_handle>        faces;
+    int                             numHits;
+    int                             numWalks;
+};
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,258 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* A uniform grid over the triangulation used to pick start faces for walks.
+*
+* Each cell of the grid remembers the vertex closest to its centre. Cells
+* store vertices rather than faces because vertices survive insertions,
+* whereas faces in the conflict zone of a new point are destroyed. A walk
+* then starts from a face incident to that vertex.
+*
+******************************************************************************/
+
+#ifndef GRID_INDEX_H
+#define GRID_INDEX_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <limits>
+
+#include "walk.h"
+#include "parallel.h"
+
+/*****************************************************************************/
+
+// Average number of vertices per cell when no resolution is given.
+const int GRID_POINTS_PER_CELL = 2;
+
+/*****************************************************************************/
+
+template <typename T>
+class GridIndex : public StartFaceOracle<T>
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+    typedef typename T::Finite_vertices_iterator        Finite_vertices_iterator;
+
+public:
+    // A resolution of 0 picks one from the number of vertices.
+                                    GridIndex(T* dt, int resolution=0);
+
+    // Rebuild the whole grid, after the triangulation has been rebuilt.
+    void                            rebuild();
+
+    // Patch the grid after v has been inserted into the triangulation.
+    void                            insert(Vertex_handle v);
+
+    Face_handle                     startFace(const Point& p);
+
+    // Number of cells along each side of the grid.
+    int                             getResolution() const { return side; }
+
+private:
+    int                             cellOf(double x, double y) const;
+    double                          distanceToCentre(int cell,
+                                                     const Point& p) const;
+
+    /*************************************************************************/
+
+    // Computes the cell and squared distance to its centre for a chunk of
+    // vertices.
+    struct CellAssigner
+    {
+        const GridIndex*            grid;
+        const Vertex_handle*        vertices;
+        int*                        cell;
+        double*                     distance;
+
+        void operator()(int, int begin, int end)
+        {
+            for (int i=begin; i<end; i++)
+            {
+                const Point& p = vertices[i]->point();
+                cell[i]        = grid->cellOf(p.x(), p.y());
+                distance[i]    = grid->distanceToCentre(cell[i], p);
+            }
+        }
+    };
+
+    /*************************************************************************/
+
+    T*                              dt;
+    int                             requested;
+    int                             side;
+    double                          min_x;
+    double                          min_y;
+    double                          cell_w;
+    double                          cell_h;
+    std::vector<Vertex_handle>      cells;
+};
+
+/*****************************************************************************/
+
+template <typename T>
+GridIndex<T>::GridIndex(T* dt, int resolution)
+{
+    this->dt  = dt;
+    requested = resolution;
+    rebuild();
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void GridIndex<T>::rebuild()
+{
+    cells.clear();
+    side = 0;
+
+    if (dt->number_of_vertices() == 0)
+        return;
+
+    std::vector<Vertex_handle> vertices;
+    vertices.reserve(dt->number_of_vertices());
+
+    Finite_vertices_iterator v;
+    for (v = dt->finite_vertices_begin(); v != dt->finite_vertices_end(); ++v)
+        vertices.push_back(v);
+
+    // Bounding box of the vertices.
+    double max_x, max_y;
+    min_x = max_x = vertices[0]->point().x();
+    min_y = max_y = vertices[0]->point().y();
+    for (unsigned int i=1; i<vertices.size(); i++)
+    {
+        const Point& p = vertices[i]->point();
+        min_x = std::min(min_x, (double)p.x());
+        min_y = std::min(min_y, (double)p.y());
+        max_x = std::max(max_x, (double)p.x());
+        max_y = std::max(max_y, (double)p.y());
+    }
+
+    side = requested;
+    if (side <= 0)
+        side = (int)std::ceil(std::sqrt(vertices.size()
+                                        / (double)GRID_POINTS_PER_CELL));
+    side = std::max(side, 1);
+
+    // Avoid empty extents for degenerate (collinear) pointsets.
+    cell_w = std::max(max_x - min_x, 1e-12) / side;
+    cell_h = std::max(max_y - min_y, 1e-12) / side;
+
+    // Find the cell of every vertex in parallel.
+    std::vector<int>    cell    (vertices.size());
+    std::vector<double> distance(vertices.size());
+
+    CellAssigner assign;
+    assign.grid     = this;
+    assign.vertices = &vertices[0];
+    assign.cell     = &cell[0];
+    assign.distance = &distance[0];
+    parallelChunks(vertices.size(), 16384, assign);
+
+    // Keep the vertex closest to the centre of each cell.
+    std::vector<double> best(side*side, std::numeric_limits<double>::max());
+    cells.assign(side*side, Vertex_handle());
+
+    for (unsigned int i=0; i<vertices.size(); i++)
+    {
+        if (distance[i] < best[cell[i]])
+        {
+            best [cell[i]] = distance[i];
+            cells[cell[i]] = vertices[i];
+        }
+    }
+
+    // Empty cells take the vertex of their nearest non-empty neighbour,
+    // found by a breadth first search out from the filled cells.
+    std::vector<int> queue;
+    for (int c=0; c<side*side; c++)
+        if (cells[c] != Vertex_handle())
+            queue.push_back(c);
+
+    for (unsigned int q=0; q<queue.size(); q++)
+    {
+        int c = queue[q];
+        int x = c % side;
+        int y = c / side;
+
+        const int dx[4] = { 1, -1, 0,  0 };
+        const int dy[4] = { 0,  0, 1, -1 };
+
+        for (int k=0; k<4; k++)
+        {
+            int nx = x + dx[k];
+            int ny = y + dy[k];
+            if (nx < 0 || ny < 0 || nx >= side || ny >= side)
+                continue;
+
+            int n = ny*side + nx;
+            if (cells[n] == Vertex_handle())
+            {
+                cells[n] = cells[c];
+                queue.push_back(n);
+            }
+        }
+    }
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void GridIndex<T>::insert(Vertex_handle v)
+{
+    if (cells.empty())
+    {
+        rebuild();
+        return;
+    }
+
+    // Points outside the original bounding box are clamped to the border
+    // cells, the grid is not grown.
+    const Point& p = v->point();
+    int c = cellOf(p.x(), p.y());
+
+    if (distanceToCentre(c, p) < distanceToCentre(c, cells[c]->point()))
+        cells[c] = v;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+typename T::Face_handle GridIndex<T>::startFace(const Point& p)
+{
+    if (cells.empty())
+        return dt->infinite_face();
+
+    return cells[cellOf(p.x(), p.y())]->face();
+}
+
+/*****************************************************************************/
+
+template <typename T>
+int GridIndex<T>::cellOf(double x, double y) const
+{
+    // Clamp before converting, far away points would overflow an int.
+    double cx = std::max(0., std::min(side-1., std::floor((x-min_x) / cell_w)));
+    double cy = std::max(0., std::min(side-1., std::floor((y-min_y) / cell_h)));
+
+    return (int)cy*side + (int)cx;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+double GridIndex<T>::distanceToCentre(int cell, const Point& p) const
+{
+    double dx = p.x() - (min_x + (cell % side + 0.5) * cell_w);
+    double dy = p.y() - (min_y + (cell / side + 0.5) * cell_h);
+    return dx*dx + dy*dy;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,210 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* The convex hull in angular order, for entering the triangulation from
+* outside in O(log h).
+*
+* Hull vertices are kept in counter-clockwise order with their angle about
+* a point inside the hull. The hull edges then split the plane into wedges
+* about that point, and the wedge containing a query is found by binary
+* search on the angles. If the query is outside the hull, the hull edge of
+* its wedge is visible from it. Angles only guide the search; the wedge is
+* confirmed with exact orientations.
+*
+******************************************************************************/
+
+#ifndef HULL_INDEX_H
+#define HULL_INDEX_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <CGAL/Unique_hash_map.h>
+
+#include "walk.h"
+
+/*****************************************************************************/
+
+template <typename T>
+class HullIndex : public StartFaceOracle<T>
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+    typedef typename T::Face_circulator                 Face_circulator;
+
+public:
+                                    HullIndex(T* dt);
+
+    // Rebuild the index, after the triangulation has changed.
+    void                            rebuild();
+
+    // The finite face on the hull edge facing p. A walk from here to a
+    // point near the boundary is short, and never has to leave the
+    // infinite face.
+    Face_handle                     startFace(const Point& p);
+
+    // If p is outside the hull, an infinite face whose hull edge is visible
+    // from p, which is a valid answer to locate(p). Otherwise null.
+    Face_handle                     visibleFace(const Point& p);
+
+    // Number of vertices on the hull.
+    int                             size() const { return hull.size(); }
+
+private:
+    int                             edgeToward(const Point& p) const;
+    bool                            inWedge(int i, const Point& p) const;
+
+    T*                              dt;
+    Point                           centre;
+
+    // Edge i goes from hull[i] to hull[i+1], with the finite face inside it
+    // and the infinite face outside.
+    std::vector<Vertex_handle>      hull;
+    std::vector<double>             angles;
+    std::vector<Face_handle>        inside;
+    std::vector<Face_handle>        outside;
+};
+
+/*****************************************************************************/
+
+template <typename T>
+HullIndex<T>::HullIndex(T* dt)
+{
+    this->dt = dt;
+    rebuild();
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void HullIndex<T>::rebuild()
+{
+    hull.clear();
+    angles.clear();
+    inside.clear();
+    outside.clear();
+
+    if (dt->dimension() < 2)
+        return;
+
+    // In the infinite face (inf, a, b), counter-clockwise, the hull runs
+    // from b to a. Collect the edges and then chain them in order.
+    Vertex_handle                inf = dt->infinite_vertex();
+    std::vector<Face_handle>     faces;
+    Face_circulator              c   = dt->incident_faces(inf), done(c);
+    do {
+        faces.push_back(c);
+    } while (++c != done);
+
+    CGAL::Unique_hash_map<Vertex_handle, int> from;
+    for (unsigned int i=0; i<faces.size(); i++)
+        from[faces[i]->vertex(faces[i]->cw(faces[i]->index(inf)))] = i;
+
+    double x = 0, y = 0;
+    int    e = 0;
+    for (unsigned int k=0; k<faces.size(); k++)
+    {
+        Face_handle f = faces[e];
+        int         i = f->index(inf);
+
+        hull.push_back(f->vertex(f->cw(i)));
+        outside.push_back(f);
+        inside.push_back(f->neighbor(i));
+
+        x += hull.back()->point().x();
+        y += hull.back()->point().y();
+
+        e = from[f->vertex(f->ccw(i))];
+    }
+
+    // The centroid of the hull vertices is strictly inside the hull.
+    centre = Point(x / hull.size(), y / hull.size());
+
+    // Angles increase counter-clockwise from the first vertex.
+    for (unsigned int i=0; i<hull.size(); i++)
+    {
+        double a = std::atan2(hull[i]->point().y() - centre.y(),
+                              hull[i]->point().x() - centre.x());
+        while (i > 0 && a < angles.back())
+            a += 2 * M_PI;
+        angles.push_back(a);
+    }
+}
+
+/*****************************************************************************/
+
+// True if p is in the wedge from the centre between hull[i] (inclusive) and
+// hull[i+1] (exclusive). Every wedge is less than a half plane.
+template <typename T>
+bool HullIndex<T>::inWedge(int i, const Point& p) const
+{
+    const Point& a = hull[i]->point();
+    const Point& b = hull[(i+1) % hull.size()]->point();
+
+    return dt->orientation(centre, a, p) != CGAL::RIGHT_TURN
+        && dt->orientation(centre, b, p) == CGAL::RIGHT_TURN;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+int HullIndex<T>::edgeToward(const Point& p) const
+{
+    int    h = hull.size();
+    double a = std::atan2(p.y() - centre.y(), p.x() - centre.x());
+    while (a <  angles[0])          a += 2 * M_PI;
+    while (a >= angles[0] + 2*M_PI) a -= 2 * M_PI;
+
+    int i = std::upper_bound(angles.begin(), angles.end(), a)
+          - angles.begin() - 1;
+
+    // Rounding in the angles can put p one wedge out, near a wedge
+    // boundary. Look either side, and round the hull if all else fails.
+    for (int k=0; k<h; k++)
+    {
+        int j = (i + (k % 2 ? (k+1)/2 : h - k/2)) % h;
+        if (inWedge(j, p))
+            return j;
+    }
+
+    // p is the centre itself.
+    return i;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+typename T::Face_handle HullIndex<T>::startFace(const Point& p)
+{
+    if (hull.empty())
+        return dt->infinite_face();
+
+    return inside[edgeToward(p)];
+}
+
+/*****************************************************************************/
+
+template <typename T>
+typename T::Face_handle HullIndex<T>::visibleFace(const Point& p)
+{
+    if (hull.empty())
+        return Face_handle();
+
+    int i = edgeToward(p);
+
+    if (dt->orientation(hull[i]->point(),
+                        hull[(i+1) % hull.size()]->point(),
+                        p) == CGAL::RIGHT_TURN)
+        return outside[i];
+
+    return Face_handle();
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
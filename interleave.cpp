@@ -0,0 +1,158 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Throughput of interleaved walks against walks run one after another.
+******************************************************************************/
+
+#include <iostream>
+#include <boost/format.hpp>
+
+#include "benchmark.h"
+#include "walk_stepper.h"
+
+/*****************************************************************************/
+
+template <typename S>
+static void makeSteppers(Delaunay*                       dt,
+                         const std::vector<Point>&       targets,
+                         const std::vector<Face_handle>& starts,
+                         std::vector<S>&                 walks)
+{
+    walks.clear();
+    walks.reserve(targets.size());
+    for (unsigned int i=0; i<targets.size(); i++)
+        walks.push_back(S(targets[i], dt, starts[i], i));
+}
+
+/*****************************************************************************/
+
+// True if every walk ended in the face locate() finds for its target, or in
+// another face whose closure holds it, as when the target is on an edge.
+template <typename S>
+static bool allLocated(Delaunay*                 dt,
+                       const std::vector<Point>& targets,
+                       const std::vector<S>&     walks)
+{
+    for (unsigned int i=0; i<walks.size(); i++)
+    {
+        Face_handle f = walks[i].face();
+        if (f == dt->locate(targets[i]))
+            continue;
+
+        if (f == Face_handle() || dt->is_infinite(f))
+            return false;
+
+        for (int k=0; k<3; k++)
+            if (dt->orientation(f->vertex(f->ccw(k))->point(),
+                                f->vertex(f->cw(k))->point(), targets[i])
+                                                        == CGAL::RIGHT_TURN)
+                return false;
+    }
+    return true;
+}
+
+/*****************************************************************************/
+
+// Time the steppers of type S run sequentially and interleaved at each
+// width, against the constructor-driven walk W.
+template <typename W, typename S>
+static void interleaveRows(const char*                     name,
+                           Delaunay*                       dt,
+                           const std::vector<Point>&       targets,
+                           const std::vector<Face_handle>& starts,
+                           const QList<int>&               widths)
+{
+    int n = dt->number_of_vertices();
+    double q = qMax<size_t>(1, targets.size());
+
+    double walkNs = measureWalks<W>(dt, targets, starts).ns;
+    std::cout << boost::format("%-12s %10d %-12s %12.1f %9s %8s %8s\n")
+                 % name % n % "walk.h" % walkNs % "-" % "-" % "-";
+
+    QElapsedTimer   timer;
+    std::vector<S>  sequential;
+    makeSteppers(dt, targets, starts, sequential);
+
+    timer.start();
+    runSequential(sequential);
+    double sequentialNs = timer.nsecsElapsed() / q;
+
+    std::cout << boost::format("%-12s %10d %-12s %12.1f %9.2f %8s %8s\n")
+                 % name % n % "sequential" % sequentialNs
+                 % (sequentialNs / sequentialNs) % "-"
+                 % (allLocated(dt, targets, sequential) ? "yes" : "no");
+
+    for (int w=0; w<widths.size(); w++)
+    {
+        std::vector<S> walks;
+        makeSteppers(dt, targets, starts, walks);
+
+        timer.start();
+        runInterleaved(walks, widths[w]);
+        double ns = timer.nsecsElapsed() / q;
+
+        // Walks are deterministic, so interleaving must not change where
+        // any of them end.
+        bool same = true;
+        for (unsigned int i=0; i<walks.size(); i++)
+            same = same && walks[i].face() == sequential[i].face();
+
+        std::cout << boost::format("%-12s %10d %-12s %12.1f %9.2f %8s %8s\n")
+                     % name % n
+                     % QString("width %1").arg(widths[w]).toStdString()
+                     % ns % (sequentialNs / ns) % (same ? "yes" : "no")
+                     % (allLocated(dt, targets, walks) ? "yes" : "no");
+    }
+}
+
+/*****************************************************************************/
+
+// Compare walks run to completion one at a time with the same walks
+// interleaved round-robin with prefetching, at several numbers of walks in
+// flight. Meshes should be large enough not to fit in cache. The located
+// column checks where the steppers end against the triangulation's locate.
+//
+//  --interleave     Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --width          Comma separated numbers of walks in flight.
+//  --queries        Number of walks per strategy.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+int runInterleaveBenchmark(const QStringList& args)
+{
+    QList<int>   sizes   = argIntList(args, "--n",     "1000000,4000000");
+    QList<int>   widths  = argIntList(args, "--width", "2,4,8,16,32");
+    QList<int>   dists   = argDistributions(args);
+    int          queries = argValue(args, "--queries", "100000").toInt();
+    unsigned int seed    = argValue(args, "--seed",    "1"     ).toUInt();
+    int          dist    = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-12s %10s %-12s %12s %9s %8s %8s\n")
+                 % "strategy" % "n" % "schedule" % "ns/query" % "speedup"
+                 % "same" % "located";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        Delaunay dt;
+        buildTriangulation(&dt, dist, sizes[s], seed);
+
+        std::vector<Point>       targets;
+        std::vector<Face_handle> starts;
+        makeQueries(&dt, dist, queries, seed, targets, starts);
+
+        interleaveRows< StraightWalk<Delaunay>,
+                        StraightStepper<Delaunay> >
+            ("straight",   &dt, targets, starts, widths);
+        interleaveRows< VisibilityWalk<Delaunay>,
+                        VisibilityStepper<Delaunay> >
+            ("visibility", &dt, targets, starts, widths);
+        interleaveRows< PivotWalk<Delaunay>,
+                        PivotStepper<Delaunay> >
+            ("pivot",      &dt, targets, starts, widths);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,95 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Jump-and-walk start faces.
+*
+* A fixed random sample of about n^(1/3) vertices is kept, and each walk
+* starts next to the sampled vertex closest to its target.
+*
+******************************************************************************/
+
+#ifndef JUMP_AND_WALK_H
+#define JUMP_AND_WALK_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <vector>
+
+#include <CGAL/Random.h>
+
+#include "walk.h"
+
+/*****************************************************************************/
+
+template <typename T>
+class JumpAndWalk : public StartFaceOracle<T>
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+    typedef typename T::Finite_vertices_iterator        Finite_vertices_iterator;
+
+public:
+    // A sample size of 0 uses n^(1/3).
+    JumpAndWalk(T* dt, int samples=0, unsigned int seed=0)
+    {
+        this->dt = dt;
+
+        std::vector<Vertex_handle> vertices;
+        Finite_vertices_iterator v;
+        for (v=dt->finite_vertices_begin(); v!=dt->finite_vertices_end(); ++v)
+            vertices.push_back(v);
+
+        if (vertices.empty())
+            return;
+
+        if (samples <= 0)
+            samples = (int)std::ceil(std::pow((double)vertices.size(), 1/3.));
+
+        CGAL::Random random(seed);
+        for (int i=0; i<samples; i++)
+            sample.push_back(vertices[random.get_int(0, vertices.size())]);
+    }
+
+    /*************************************************************************/
+
+    Face_handle startFace(const Point& p)
+    {
+        if (sample.empty())
+            return dt->infinite_face();
+
+        Vertex_handle best   = sample[0];
+        double        best_d = squaredDistance(best->point(), p);
+
+        for (unsigned int i=1; i<sample.size(); i++)
+        {
+            double d = squaredDistance(sample[i]->point(), p);
+            if (d < best_d)
+            {
+                best   = sample[i];
+                best_d = d;
+            }
+        }
+
+        return best->face();
+    }
+
+    /*************************************************************************/
+
+private:
+    static double squaredDistance(const Point& a, const Point& b)
+    {
+        double dx = a.x() - b.x();
+        double dy = a.y() - b.y();
+        return dx*dx + dy*dy;
+    }
+
+    T*                              dt;
+    std::vector<Vertex_handle>      sample;
+};
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
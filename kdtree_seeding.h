@@ -0,0 +1,149 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Start faces from an approximate nearest vertex, found with a kd-tree.
+*
+* Unlike a grid, a kd-tree adapts to the density of the points, so it keeps
+* seeding walks close to their targets on highly non-uniform data. The tree
+* is bulk built from every vertex, and once built it can answer batches of
+* queries in parallel.
+*
+******************************************************************************/
+
+#ifndef KDTREE_SEEDING_H
+#define KDTREE_SEEDING_H
+
+/*****************************************************************************/
+
+#include <vector>
+#include <utility>
+
+#include <CGAL/Search_traits_2.h>
+#include <CGAL/Search_traits_adapter.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
+#include <CGAL/property_map.h>
+
+#include "walk.h"
+#include "parallel.h"
+
+/*****************************************************************************/
+
+template <typename T>
+class KdTreeSeeding : public StartFaceOracle<T>
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+    typedef typename T::Geom_traits                     Gt;
+    typedef typename T::Finite_vertices_iterator        Finite_vertices_iterator;
+
+    typedef std::pair<Point, Vertex_handle>             Point_with_vertex;
+    typedef CGAL::Search_traits_2<Gt>                   Traits_base;
+    typedef CGAL::Search_traits_adapter<
+                Point_with_vertex,
+                CGAL::First_of_pair_property_map<Point_with_vertex>,
+                Traits_base >                           Traits;
+    typedef CGAL::Orthogonal_k_neighbor_search<Traits>  Neighbor_search;
+    typedef typename Neighbor_search::Tree              Tree;
+
+public:
+    // Queries return a vertex within a factor (1 + epsilon) of the distance
+    // to the true nearest vertex. Exact search is epsilon = 0.
+                                    KdTreeSeeding(T* dt, double epsilon=0.5);
+
+    // Rebuild the tree, after the triangulation has been rebuilt.
+    void                            rebuild();
+
+    Face_handle                     startFace(const Point& p);
+
+    // Find start faces for a batch of targets in parallel.
+    void                            startFaces(
+                                        const std::vector<Point>&  targets,
+                                        std::vector<Face_handle>&  faces);
+
+private:
+    /*************************************************************************/
+
+    struct BatchQuery
+    {
+        KdTreeSeeding*              seeding;
+        const Point*                targets;
+        Face_handle*                faces;
+
+        void operator()(int, int begin, int end)
+        {
+            for (int i=begin; i<end; i++)
+                faces[i] = seeding->startFace(targets[i]);
+        }
+    };
+
+    /*************************************************************************/
+
+    T*                              dt;
+    double                          epsilon;
+    Tree                            tree;
+};
+
+/*****************************************************************************/
+
+template <typename T>
+KdTreeSeeding<T>::KdTreeSeeding(T* dt, double epsilon)
+{
+    this->dt      = dt;
+    this->epsilon = epsilon;
+    rebuild();
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void KdTreeSeeding<T>::rebuild()
+{
+    std::vector<Point_with_vertex> points;
+    points.reserve(dt->number_of_vertices());
+
+    Finite_vertices_iterator v;
+    for (v = dt->finite_vertices_begin(); v != dt->finite_vertices_end(); ++v)
+        points.push_back(Point_with_vertex(v->point(), v));
+
+    // Build now rather than on the first query, so that queries can run
+    // concurrently and the build is not counted as query time.
+    tree.clear();
+    tree.insert(points.begin(), points.end());
+    tree.build();
+}
+
+/*****************************************************************************/
+
+template <typename T>
+typename T::Face_handle KdTreeSeeding<T>::startFace(const Point& p)
+{
+    if (tree.size() == 0)
+        return dt->infinite_face();
+
+    Neighbor_search search(tree, p, 1, epsilon);
+    return search.begin()->first.second->face();
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void KdTreeSeeding<T>::startFaces(const std::vector<Point>&  targets,
+                                  std::vector<Face_handle>&  faces)
+{
+    faces.resize(targets.size());
+    if (targets.empty())
+        return;
+
+    BatchQuery query;
+    query.seeding = this;
+    query.targets = &targets[0];
+    query.faces   = &faces[0];
+
+    parallelChunks(targets.size(), 1024, query);
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,146 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Alternative kernels that the walks and triangulations can be built on.
+*
+* The walks only use predicates through the triangulation's traits, so any
+* of these can be used as the Gt of a Triangulation_2 or Delaunay_2 and
+* chosen at compile time.
+*
+******************************************************************************/
+
+#ifndef KERNELS_H
+#define KERNELS_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <CGAL/Simple_cartesian.h>
+#include <CGAL/Filtered_kernel.h>
+#include <CGAL/Exact_predicates_inexact_constructions_kernel.h>
+
+/*****************************************************************************/
+
+// Doubles with dynamic (interval arithmetic) filters only. EPICK adds static
+// filters on top of this.
+typedef CGAL::Filtered_kernel< CGAL::Simple_cartesian<double>, false >
+                                                    Filtered_double_kernel;
+
+/*****************************************************************************/
+
+// Points given to Integer_grid_kernel must have integer coordinates of
+// magnitude strictly less than 2^GRID_BITS.
+const int       GRID_BITS   = 26;
+
+// Scale used to snap generated points (which lie within about +-400) on to
+// the integer grid.
+const double    GRID_SCALE  = 65536.;
+
+/******************************************************************************
+* A kernel for points snapped to a bounded integer grid.
+*
+* Coordinates are stored as doubles, which represent the grid exactly, but
+* the predicates are evaluated in integer arithmetic. With coordinates below
+* 2^26 the orientation determinant fits in 64 bits and the in-circle
+* determinant fits in 128 bits, so both are exact without any filtering.
+******************************************************************************/
+
+struct Integer_grid_kernel : public CGAL::Simple_cartesian<double>
+{
+    typedef CGAL::Simple_cartesian<double>::Point_2     Point_2;
+
+    /*************************************************************************/
+
+    struct Orientation_2
+    {
+        typedef CGAL::Orientation result_type;
+
+        result_type operator()(const Point_2& p,
+                               const Point_2& q,
+                               const Point_2& r) const
+        {
+            long long px = (long long)p.x(), py = (long long)p.y();
+            long long qx = (long long)q.x(), qy = (long long)q.y();
+            long long rx = (long long)r.x(), ry = (long long)r.y();
+
+            long long d = (qx-px)*(ry-py) - (qy-py)*(rx-px);
+
+            // Sign without branches.
+            return static_cast<result_type>((d > 0) - (d < 0));
+        }
+    };
+
+    /*************************************************************************/
+
+    struct Side_of_oriented_circle_2
+    {
+        typedef CGAL::Oriented_side result_type;
+
+        // Same determinant as CGAL's side_of_oriented_circleC2, with the
+        // final 2x2 determinant computed in 128 bits.
+        result_type operator()(const Point_2& p,
+                               const Point_2& q,
+                               const Point_2& r,
+                               const Point_2& t) const
+        {
+            long long px = (long long)p.x(), py = (long long)p.y();
+            long long qx = (long long)q.x(), qy = (long long)q.y();
+            long long rx = (long long)r.x(), ry = (long long)r.y();
+            long long tx = (long long)t.x(), ty = (long long)t.y();
+
+            long long qpx = qx-px, qpy = qy-py;
+            long long rpx = rx-px, rpy = ry-py;
+            long long tpx = tx-px, tpy = ty-py;
+
+            __int128 a00 = qpx*tpy - qpy*tpx;
+            __int128 a01 = tpx*(tx-qx) + tpy*(ty-qy);
+            __int128 a10 = qpx*rpy - qpy*rpx;
+            __int128 a11 = rpx*(rx-qx) + rpy*(ry-qy);
+
+            __int128 d = a00*a11 - a10*a01;
+
+            return static_cast<result_type>((d > 0) - (d < 0));
+        }
+    };
+
+    /*************************************************************************/
+
+    Orientation_2 orientation_2_object() const
+    {
+        return Orientation_2();
+    }
+
+    Side_of_oriented_circle_2 side_of_oriented_circle_2_object() const
+    {
+        return Side_of_oriented_circle_2();
+    }
+};
+
+/*****************************************************************************/
+
+// Snap a coordinate on to the integer grid, clamping far outliers (such as
+// the tail of the Kuzmin distribution) to the representable range.
+inline double snapToGrid(double x)
+{
+    const double limit = (double)((1LL << GRID_BITS) - 1);
+    return std::max(-limit, std::min(limit, std::floor(x * GRID_SCALE + 0.5)));
+}
+
+/*****************************************************************************/
+
+// Snap a set of points on to the grid in place.
+template <typename Point>
+void snapToGrid(std::vector<Point>& points)
+{
+    for (unsigned int i=0; i<points.size(); i++)
+        points[i] = Point(snapToGrid(points[i].x()),
+                          snapToGrid(points[i].y()));
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
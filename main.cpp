@@ -5,11 +5,57 @@
 
 #include <QApplication>
 #include "mainwindow.h"
+#include "benchmark.h"
+
+/*****************************************************************************/
+
+// Headless modes, selected by a command-line flag.
+struct Tool
+{
+    const char*  flag;
+    int        (*run)(const QStringList& args);
+};
+
+static const Tool tools[] =
+{
+    { "--record",      runRecord               },
+    { "--replay",      runReplay               },
+    { "--perf-check",  runPerfCheck            },
+    { "--perf-update", runPerfCheck            },
+    { "--kernels",     runKernelBenchmark      },
+    { "--seeding",     runSeedingBenchmark     },
+    { "--construction", runConstructionBenchmark},
+    { "--render",      runRender               },
+    { "--sweep",       runSweep                },
+    { "--meshes",      runMeshBenchmark        },
+    { "--interleave",  runInterleaveBenchmark  },
+    { "--segments",    runSegmentBenchmark     },
+    { "--nearest",     runNearestBenchmark     },
+    { "--compact",     runCompactBenchmark     },
+    { "--cache",       runCacheBenchmark       },
+    { "--numa",        runNumaBenchmark        },
+    { "--stress",      runStressTest           },
+    { "--benchmark",   runBenchmark            },
+};
 
 /*****************************************************************************/
 
 int main(int argc, char **argv)
 {    	    
+    QStringList args;
+    for (int i=1; i<argc; i++)
+        args << argv[i];
+    
+    // Headless modes do not need a display.
+    for (unsigned int i=0; i<sizeof(tools)/sizeof(Tool); i++)
+    {
+        if (args.contains(tools[i].flag))
+        {
+            QApplication app(argc, argv, false);
+            return tools[i].run(args);
+        }
+    }
+    
     QApplication app(argc, argv);
 
 
@@ -18,7 +64,7 @@ int main(int argc, char **argv)
     app.setApplicationName("Walk Visualisation Demo");
 
 
-    MainWindow *window = new MainWindow();   
+    MainWindow *window = new MainWindow(argValue(args, "--session"));
     window->show();
 
     return app.exec();
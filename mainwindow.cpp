@@ -5,6 +5,8 @@
 
 #include <iostream>
 #include <fstream>
+#include <vector>
+#include <ctime>
 #include <boost/format.hpp>
 
 #include <QtGui>
@@ -12,6 +14,7 @@
 #include <QLineF>
 #include <QRectF>
 #include <QGraphicsPolygonItem>
+#include <QtConcurrentRun>
 
 #include <CGAL/Qt/Converter.h>
 #include <CGAL/Qt/GraphicsViewNavigation.h>
@@ -23,6 +26,14 @@
 
 #include "mainwindow.h"
 #include "walk.h"
+#include "grid_index.h"
+#include "triangulation_builder.h"
+#include "session.h"
+
+/*****************************************************************************/
+
+// Fastest refresh of the performance panel, in milliseconds.
+const int PERF_REFRESH_MS = 200;
 
 
 /*****************************************************************************/
@@ -73,6 +84,9 @@ void MainWindow::pivotWalk_checkbox_change(int state)
 void MainWindow::updateScene()
 {
         
+    QElapsedTimer updateTimer;
+    updateTimer.start();
+
     // Style for points.
     QPen   pen(Qt::black);
     QBrush brush(Qt::blue);
@@ -87,7 +101,10 @@ void MainWindow::updateScene()
     if (inputPoints >= 0)
     {
         // Find the face we are hovering over.
-        Face_handle f = dt->locate(c(points[0]));
+        QElapsedTimer locateTimer;
+        locateTimer.start();
+        Face_handle f = locate(c(points[0]));
+        locateTimes.add(locateTimer.nsecsElapsed());
         
         // Check the face is finite, and then draw it.
         if (!dt->is_infinite(f))
@@ -101,14 +118,18 @@ void MainWindow::updateScene()
     // If we have enough data to plot a walk, then do so.
     if (inputPoints > 0) 
     {
-        Face_handle f = dt->locate(c(points[0]));
-        Face_handle g = dt->locate(c(points[1]));
+        Face_handle f = locate(c(points[0]));
+        Face_handle g = locate(c(points[1]));
         
         if ( !dt->is_infinite(f) && !dt->is_infinite(g) )
         {                
             if (drawStraightWalk)
             {
+                QElapsedTimer walkTimer;
+                walkTimer.start();
                 StraightWalk<Delaunay> w(c(points[1]), dt, f);
+                walkTimes[0].add(walkTimer.nsecsElapsed());
+
                 QGraphicsItem* walkGraphics = w.getGraphics(QPen(),QColor("#EBEBD2"));
                 walkItems.append(walkGraphics);
                 scene->addItem(walkGraphics);     
@@ -116,15 +137,24 @@ void MainWindow::updateScene()
                 details += "<b>Straight Walk</b><br>";                
                 details += "Orientations: ";
                 details += QString::number(w.getNumOrientationsPerformed());
+                details += "<br>Cached Orientations: ";
+                details += QString::number(w.getNumOrientationCacheHits());
                 details += "<br>Triangles Visited: ";
                 details += QString::number(w.getNumTrianglesVisited());
+                details += "<br>Time: ";
+                details += QString::number(walkTimes[0].last() / 1000);
+                details += " us";
                 details += "<br><br>";
                 
             }
 
             if (drawVisibilityWalk)
             {
+                QElapsedTimer walkTimer;
+                walkTimer.start();
                 VisibilityWalk<Delaunay> w(c(points[1]), dt, f);
+                walkTimes[1].add(walkTimer.nsecsElapsed());
+
                 QGraphicsItem* walkGraphics = w.getGraphics(QPen(),
                                                             QColor("#D2D2EB"));
                 walkItems.append(walkGraphics);
@@ -133,15 +163,24 @@ void MainWindow::updateScene()
                 details += "<b>Visibility Walk</b><br>";                
                 details += "Orientations: ";
                 details += QString::number(w.getNumOrientationsPerformed());
+                details += "<br>Cached Orientations: ";
+                details += QString::number(w.getNumOrientationCacheHits());
                 details += "<br>Triangles Visited: ";
                 details += QString::number(w.getNumTrianglesVisited());
+                details += "<br>Time: ";
+                details += QString::number(walkTimes[1].last() / 1000);
+                details += " us";
                 details += "<br><br>";
 
             }   
     
             if (drawPivotWalk)
             {
+                QElapsedTimer walkTimer;
+                walkTimer.start();
                 PivotWalk<Delaunay> w(c(points[1]), dt, f);
+                walkTimes[2].add(walkTimer.nsecsElapsed());
+
                 QGraphicsItem* walkGraphics = w.getGraphics(QPen(),
                                                             QColor("#EBD2D2"));
                 walkItems.append(walkGraphics);
@@ -150,8 +189,13 @@ void MainWindow::updateScene()
                 details += "<b>Pivot Walk</b><br>";        
                 details += "Orientations: ";
                 details += QString::number(w.getNumOrientationsPerformed());
+                details += "<br>Cached Orientations: ";
+                details += QString::number(w.getNumOrientationCacheHits());
                 details += "<br>Triangles Visited: ";
                 details += QString::number(w.getNumTrianglesVisited());
+                details += "<br>Time: ";
+                details += QString::number(walkTimes[2].last() / 1000);
+                details += " us";
                 details += "<br><br>";
                                          
             }                                     
@@ -166,18 +210,22 @@ void MainWindow::updateScene()
     }
     
     status->setText(details);
-    
-    
+
+    updateTimes.add(updateTimer.nsecsElapsed());
 
 }
 
 /*****************************************************************************/
 
-MainWindow::MainWindow()
+MainWindow::MainWindow(const QString& session)
 {
     
-    dt  = new Delaunay();
-    tgi = new QTriangulationGraphics(dt);
+    dt        = new Delaunay();
+    tgi       = new QTriangulationGraphics(dt);
+    grid      = 0;
+    builder   = 0;
+    restoring = 0;
+    preview   = 0;
     
     tgi->setVerticesPen(QPen(Qt::red, 5 , Qt::SolidLine, 
                                           Qt::RoundCap, 
@@ -191,7 +239,7 @@ MainWindow::MainWindow()
 
     // This is where we draw items to.
     scene = new QGraphicsScene();
-    view  = new QGraphicsView(scene);
+    view  = new TimedGraphicsView(scene);
 
     // Event filters for dealing with mouse input.
     // These are attached to both the GrahpicsView and GraphicsScene.
@@ -212,12 +260,13 @@ MainWindow::MainWindow()
     view->setRenderHint(QPainter::Antialiasing);
    
     QGroupBox    *groupBox            = new QGroupBox(tr("Walk Types"));
-    QCheckBox    *checkBox_visibility = new QCheckBox(tr("Visibility Walk"));
-    QCheckBox    *checkBox_pivot      = new QCheckBox(tr("Pivot Walk"));
-    QCheckBox    *checkBox_straight   = new QCheckBox(tr("Straight Walk"));
     QPushButton  *button_new_walk     = new QPushButton(tr("New Walk"));
     QPushButton  *button_new_pointset = new QPushButton(tr("New Pointset"));
 
+    checkBox_visibility = new QCheckBox(tr("Visibility Walk"));
+    checkBox_pivot      = new QCheckBox(tr("Pivot Walk"));
+    checkBox_straight   = new QCheckBox(tr("Straight Walk"));
+
     QHBoxLayout *hbox = new QHBoxLayout;
     hbox->addWidget( button_new_walk     );
     hbox->addWidget( button_new_pointset );
@@ -261,12 +310,25 @@ MainWindow::MainWindow()
     //status->setSizePolicy(QSizePolicy::Expanding,QSizePolicy::Expanding);    
     
         
+    // Timings of the hover updates, below the walk details.
+    perfPanel = new QLabel;
+    perfPanel->setAlignment(Qt::AlignBottom);
+    perfPanel->setTextFormat(Qt::RichText);
+
+    QVBoxLayout* side = new QVBoxLayout;
+    side->addWidget(status, 1);
+    side->addWidget(perfPanel);
+
+    perfTimer = new QTimer(this);
+    connect(perfTimer, SIGNAL(timeout()), this, SLOT(updatePerfPanel()));
+    perfTimer->start(PERF_REFRESH_MS);
+
     QGridLayout* layout = new QGridLayout;
         
     layout->setMargin(5);        
     layout->addWidget(groupBox,0,0,1,2);
     layout->addWidget(view,    1,0);
-    layout->addWidget(status,  1,1);    
+    layout->addLayout(side,    1,1);    
     layout->setColumnMinimumWidth(1,150);        
     widget->setLayout(layout);    
         
@@ -276,20 +338,52 @@ MainWindow::MainWindow()
     QString message = tr("Select the walks to draw and then click New Walk.");
     statusBar()->showMessage(message);    
 
+    // Shown while a triangulation is being built in the background.
+    progressBar   = new QProgressBar();
+    button_cancel = new QPushButton(tr("Cancel"));
+    progressBar->setRange(0,100);
+    progressBar->setMaximumWidth(150);
+    statusBar()->addPermanentWidget(progressBar);
+    statusBar()->addPermanentWidget(button_cancel);
+    progressBar->hide();
+    button_cancel->hide();
+
+    connect(button_cancel, SIGNAL(clicked()), 
+            this,          SLOT(cancelTriangulation()));
+
     dialog_newPointset = new PointGeneratorDialog();
 
-    connect(dialog_newPointset, SIGNAL(valueChanged(int)), this, SLOT(randomTriangulation(int)));
+    connect(dialog_newPointset, SIGNAL(valueChanged(int,int)), 
+            this,               SLOT(randomTriangulation(int,int)));
 
+    connect(&sessionWriter,     SIGNAL(finished()),
+            this,               SLOT(sessionSaved()));
 
-    // Create and draw a random triangulation to the graphics view.
-    randomTriangulation(100);    
+    // Reopen the last session, or create and draw a random triangulation to
+    // the graphics view.
+    sessionFile = session.isEmpty() ? defaultSessionFile() : session;
+    if (!openSession())
+        randomTriangulation(100);    
 }
 
 /*****************************************************************************/
 
 void MainWindow::resizeEvent (QResizeEvent * event)
 {    
-    view->fitInView(tgi->boundingRect(), Qt::KeepAspectRatio);    
+    if (restoring)
+        applySessionView();
+    else
+        view->fitInView(tgi->boundingRect(), Qt::KeepAspectRatio);    
+}
+
+/*****************************************************************************/
+
+void MainWindow::closeEvent(QCloseEvent* event)
+{
+    saveSession();
+    sessionWriter.waitForFinished();
+
+    QMainWindow::closeEvent(event);
 }
 
 /*****************************************************************************/
@@ -369,6 +463,7 @@ void MainWindow::createMenus()
 {
     fileMenu = menuBar()->addMenu(tr("&File"));
     fileMenu->addAction(newAct);
+    fileMenu->addAction(saveAct);
 }
 
 /*****************************************************************************/
@@ -378,29 +473,312 @@ void MainWindow::createActions()
     newAct = new QAction(tr("&New Walk"), this);
     newAct->setStatusTip(tr("Create a new Walk"));
     connect(newAct, SIGNAL(triggered()), this, SLOT(newWalk()));
+
+    saveAct = new QAction(tr("&Save Session"), this);
+    saveAct->setShortcut(QKeySequence::Save);
+    saveAct->setStatusTip(tr("Save the triangulation, view and walk, to "
+                             "reopen them next time"));
+    connect(saveAct, SIGNAL(triggered()), this, SLOT(saveSession()));
 }
 
 /*****************************************************************************/
 
-void MainWindow::randomTriangulation(int points)
+void MainWindow::randomTriangulation(int points, int distribution)
 {   
-    dt->clear();
+    // Only one build at a time, a new request replaces the old one.
+    cancelTriangulation();
 
-    // Generate a random pointset to triangulate.
-    CGAL::Random_points_in_square_2<Point,Creator> g(400.);
-    CGAL::copy_n( g, points, std::back_inserter(*dt) );
+    // The triangulation is built on a worker thread, the current one stays
+    // on screen and usable until the new one is ready.
+    builder = new TriangulationBuilder(points, distribution, time(NULL));
+
+    startBuilder(tr("Building triangulation of %1 points...").arg(points));
+}
+
+/*****************************************************************************/
+
+void MainWindow::startBuilder(const QString& message)
+{
+    connect(builder, SIGNAL(progress(int)), 
+            this,    SLOT(triangulationProgress(int)));
+    connect(builder, SIGNAL(built()), 
+            this,    SLOT(triangulationBuilt()));
+    connect(builder, SIGNAL(failed()), 
+            this,    SLOT(sessionFailed()));
+
+    progressBar->setValue(0);
+    progressBar->show();
+    button_cancel->show();
+    statusBar()->showMessage(message);
+
+    builder->start();
+}
+
+/*****************************************************************************/
+
+void MainWindow::triangulationProgress(int percent)
+{
+    // Ignore reports still queued from a build that has been replaced.
+    if (sender() != builder)
+        return;
+
+    progressBar->setValue(percent);
+}
+
+/*****************************************************************************/
+
+void MainWindow::cancelTriangulation()
+{
+    if (!builder)
+        return;
+
+    // Deleting the builder cancels it and waits for the thread to stop.
+    delete builder;
+    builder = 0;
+
+    endRestore();
+
+    progressBar->hide();
+    button_cancel->hide();
+    statusBar()->showMessage(tr("Cancelled."));
+}
+
+/*****************************************************************************/
+
+void MainWindow::triangulationBuilt()
+{
+    if (!builder || sender() != builder)
+        return;
+
+    Delaunay*            new_dt   = builder->takeTriangulation();
+    GridIndex<Delaunay>* new_grid = builder->takeGridIndex();
+
+    builder->deleteLater();
+    builder = 0;
+
+    // Swap everything over at once. We are on the GUI thread, so nothing
+    // can draw or walk on the old triangulation while this happens.
+    QTriangulationGraphics* new_tgi = new QTriangulationGraphics(new_dt);
+    new_tgi->setVerticesPen(tgi->verticesPen());
 
-    emit tgi->modelChanged();
-   
     // Clear old walk.
     inputPoints=-1;
     updateScene();
 
+    // A session may still be being written from the old triangulation.
+    sessionWriter.waitForFinished();
+
+    scene->removeItem(tgi);
+    pickBuffer.invalidate();
+    delete tgi;
+    delete grid;
+    delete dt;
+
+    dt   = new_dt;
+    grid = new_grid;
+    tgi  = new_tgi;
+    scene->addItem(tgi);
+
+    progressBar->hide();
+    button_cancel->hide();
+    statusBar()->showMessage(tr("Select the walks to draw and then click "
+                                "New Walk."));
+
     view->setSceneRect(tgi->boundingRect());
-    view->fitInView(tgi->boundingRect(), Qt::KeepAspectRatio);
-    
-    
+
+    if (restoring)
+    {
+        // Back to where the session left off, in place of the preview.
+        inputPoints = restoring->inputPoints == 2 ? 2 : -1;
+        points[0]   = restoring->points[0];
+        points[1]   = restoring->points[1];
+
+        applySessionView();
+        endRestore();
+        updateScene();
+    }
+    else
+        view->fitInView(tgi->boundingRect(), Qt::KeepAspectRatio);
 }
 
 /*****************************************************************************/
 
+// Reads only the header of the session here, the triangulation is read by a
+// builder in the background.
+bool MainWindow::openSession()
+{
+    SessionState* state = new SessionState;
+    if (!readSessionState(sessionFile, *state))
+    {
+        delete state;
+        return false;
+    }
+
+    // There is no walk yet, so this draws nothing.
+    checkBox_straight->setChecked(state->drawStraightWalk);
+    checkBox_visibility->setChecked(state->drawVisibilityWalk);
+    checkBox_pivot->setChecked(state->drawPivotWalk);
+
+    // The picture is in viewport pixels, so it is drawn without the view
+    // transform, over the empty triangulation.
+    restoring = state;
+    preview   = scene->addPixmap(QPixmap::fromImage(state->preview));
+    preview->setFlag(QGraphicsItem::ItemIgnoresTransformations);
+    preview->setZValue(1);
+
+    view->setSceneRect(state->sceneRect);
+    applySessionView();
+
+    builder = new TriangulationBuilder(sessionFile, state->gridResolution);
+    startBuilder(tr("Reopening session..."));
+
+    return true;
+}
+
+/*****************************************************************************/
+
+void MainWindow::applySessionView()
+{
+    view->setTransform(restoring->transform);
+    view->centerOn(restoring->centre);
+
+    // Keep the middle of the picture in the middle of the view.
+    if (preview)
+    {
+        QSize  size   = restoring->preview.size();
+        QPoint corner = view->viewport()->rect().center()
+                      - QPoint(size.width() / 2, size.height() / 2);
+        preview->setPos(view->mapToScene(corner));
+    }
+}
+
+/*****************************************************************************/
+
+void MainWindow::endRestore()
+{
+    delete preview;
+    delete restoring;
+
+    preview   = 0;
+    restoring = 0;
+}
+
+/*****************************************************************************/
+
+void MainWindow::sessionFailed()
+{
+    if (!builder || sender() != builder)
+        return;
+
+    builder->deleteLater();
+    builder = 0;
+
+    endRestore();
+    randomTriangulation(100);
+}
+
+/*****************************************************************************/
+
+void MainWindow::saveSession()
+{
+    // Still reopening, the file already holds this session. An empty
+    // triangulation is not worth reopening.
+    if (restoring || dt->number_of_vertices() == 0)
+        return;
+
+    // One write at a time.
+    sessionWriter.waitForFinished();
+
+    SessionState state;
+    state.transform          = view->transform();
+    state.centre             = view->mapToScene(
+                                        view->viewport()->rect().center());
+    state.sceneRect          = view->sceneRect();
+    state.drawStraightWalk   = drawStraightWalk;
+    state.drawVisibilityWalk = drawVisibilityWalk;
+    state.drawPivotWalk      = drawPivotWalk;
+    state.inputPoints        = inputPoints;
+    state.points[0]          = points[0];
+    state.points[1]          = points[1];
+    state.gridResolution     = grid ? grid->getResolution() : 0;
+    state.preview            = QPixmap::grabWidget(view->viewport()).toImage();
+
+    // The triangulation is only read while it is written, and is not
+    // deleted until the write has finished.
+    sessionWriter.setFuture(QtConcurrent::run(writeSession, sessionFile,
+                                              state, (const Delaunay*)dt));
+    statusBar()->showMessage(tr("Saving session..."));
+}
+
+/*****************************************************************************/
+
+void MainWindow::sessionSaved()
+{
+    statusBar()->showMessage(sessionWriter.result()
+                             ? tr("Session saved to %1.").arg(sessionFile)
+                             : tr("Could not save the session to %1.")
+                                                        .arg(sessionFile));
+}
+
+/*****************************************************************************/
+
+// One row of the performance panel, in microseconds.
+static QString perfRow(const QString& name, const PerfWindow& w)
+{
+    if (w.isEmpty())
+        return QString();
+
+    return QString("<tr><td>%1</td><td align=right>%2</td>"
+                   "<td align=right>%3</td><td align=right>%4</td>"
+                   "<td align=right>%5</td></tr>")
+           .arg(name)
+           .arg(w.last()            / 1000.0, 0, 'f', 1)
+           .arg(w.mean()            / 1000.0, 0, 'f', 1)
+           .arg(w.percentile(50)    / 1000.0, 0, 'f', 1)
+           .arg(w.percentile(95)    / 1000.0, 0, 'f', 1);
+}
+
+/*****************************************************************************/
+
+void MainWindow::updatePerfPanel()
+{
+    QString text = QString("<b>Timings</b> (us, last %1)<br>"
+                           "<table cellspacing=2>"
+                           "<tr><td></td><td>last</td><td>mean</td>"
+                           "<td>p50</td><td>p95</td></tr>").arg(PERF_WINDOW);
+
+    text += perfRow("Straight",   walkTimes[0]);
+    text += perfRow("Visibility", walkTimes[1]);
+    text += perfRow("Pivot",      walkTimes[2]);
+    text += perfRow("Locate",     locateTimes);
+    text += perfRow("Pick",       pickBufferTimes);
+    text += perfRow("Update",     updateTimes);
+    text += perfRow("Paint",      view->paintTimes());
+    text += "</table>";
+
+    // Avoid relayouts when nothing has changed.
+    if (text != perfPanel->text())
+        perfPanel->setText(text);
+}
+
+/*****************************************************************************/
+
+// Locate p through the face ID buffer, walking from the grid index when
+// the buffer has nothing under p.
+Face_handle MainWindow::locate(const Point& p)
+{
+    QTransform transform = view->viewportTransform();
+    QSize      size      = view->viewport()->size();
+
+    if (!pickBuffer.isCurrent(dt, transform, size))
+    {
+        QElapsedTimer timer;
+        timer.start();
+        pickBuffer.rebuild(dt, transform, size);
+        pickBufferTimes.add(timer.nsecsElapsed());
+    }
+
+    return pickBuffer.locate(p, grid);
+}
+
+/*****************************************************************************/
@@ -13,6 +13,7 @@
 #include <QLineF>
 #include <QRectF>
 #include <QGraphicsPolygonItem>
+#include <QFutureWatcher>
 
 #include <CGAL/Qt/Converter.h>
 #include <CGAL/Qt/GraphicsViewNavigation.h>
@@ -22,6 +23,16 @@
 #include <CGAL/Qt/TriangulationGraphicsItem.h>
 #include <CGAL/point_generators_2.h>
 
+#include "point_generators.h"
+#include "perfstats.h"
+#include "faceid_buffer.h"
+
+/*****************************************************************************/
+
+class TriangulationBuilder;
+template <typename T> class GridIndex;
+struct SessionState;
+
 /*****************************************************************************/
 
 struct K : CGAL::Exact_predicates_inexact_constructions_kernel {};
@@ -47,18 +58,20 @@ class PointGeneratorDialog : public QDialog
            
 signals:
     // We emit this when we have chosen a value.
-    void valueChanged(int value);
+    void valueChanged(int value, int distribution);
     
 private slots:
     // Internal handling of button click.
     void buttonClicked()
     {
-        emit valueChanged( spin_numPoints->value() );
+        emit valueChanged( spin_numPoints->value(), 
+                           combo_distribution->currentIndex() );
         this->hide();
     }
     
 private:
     QSpinBox*    spin_numPoints;
+    QComboBox*   combo_distribution;
     QPushButton* button_create;
     QLabel*      label_info;    
     QGridLayout* layout;    
@@ -77,9 +90,16 @@ public:
         label_info     = new QLabel(tr("Number of points to add"));
         spin_numPoints = new QSpinBox();
         button_create  = new QPushButton(tr("Generate"));
-        layout->addWidget(label_info,    0,0,1,2);
-        layout->addWidget(spin_numPoints,1,0);
-        layout->addWidget(button_create, 1,1);
+        
+        // The order of the items matches the PointDistribution enum.
+        combo_distribution = new QComboBox();
+        for (int i=0; i<NUM_DISTRIBUTIONS; i++)
+            combo_distribution->addItem(tr(distributionName(i)));
+        
+        layout->addWidget(label_info,         0,0,1,2);
+        layout->addWidget(spin_numPoints,     1,0);
+        layout->addWidget(combo_distribution, 1,1);
+        layout->addWidget(button_create,      2,1);
         
         // Minimum size of the random pointset.
         spin_numPoints->setMinimum(1);
@@ -102,11 +122,15 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-                                    MainWindow();
+    // The session is reopened from, and saved on closing to, the given
+    // file, or to defaultSessionFile() if none is given.
+                                    MainWindow(const QString& session
+                                                                = QString());
 
 protected:
     bool                            eventFilter(QObject *obj, QEvent *event);    
     void                            resizeEvent (QResizeEvent * event);
+    void                            closeEvent(QCloseEvent* event);
 
 private slots:
     void                            newWalk();   
@@ -115,13 +139,28 @@ private slots:
     void                            straightWalk_checkbox_change(int state);
     void                            visibilityWalk_checkbox_change(int state);
     void                            pivotWalk_checkbox_change(int state);
+    void                            triangulationProgress(int percent);
+    void                            triangulationBuilt();
+    void                            cancelTriangulation();
+    void                            updatePerfPanel();
+    void                            sessionSaved();
+    void                            sessionFailed();
 
 public slots:    
-    void                            randomTriangulation(int points);    
+    void                            randomTriangulation(int points, 
+                                                        int distribution=0);
+
+    // Write the session in the background.
+    void                            saveSession();
     
 private:
     void                            createMenus();
     void                            createActions();    
+    void                            startBuilder(const QString& message);
+    bool                            openSession();
+    void                            applySessionView();
+    void                            endRestore();
+    Face_handle                     locate(const Point& p);
     bool                            drawPivotWalk;
     bool                            drawStraightWalk;
     bool                            drawVisibilityWalk;
@@ -129,12 +168,42 @@ private:
     QMenu*                          fileMenu;
     QLabel*                         status;    
     QAction*                        newAct;        
-    QGraphicsView*                  view;
+    QAction*                        saveAct;
+    QCheckBox*                      checkBox_visibility;
+    QCheckBox*                      checkBox_pivot;
+    QCheckBox*                      checkBox_straight;
+    TimedGraphicsView*              view;
     QGraphicsScene*                 scene;    
     Delaunay*                       dt;
+    GridIndex<Delaunay>*            grid;
+    TriangulationBuilder*           builder;
+    QProgressBar*                   progressBar;
+    QPushButton*                    button_cancel;
     CGAL::Qt::Converter<K>          c;
     QTriangulationGraphics*         tgi; 
     QList<QGraphicsItem*>           walkItems;
+
+    // Face IDs painted at view resolution, so that hovering over a face
+    // does not need a walk. Rebuilt on the next locate after the view or
+    // the triangulation changes.
+    FaceIdBuffer<Delaunay>          pickBuffer;
+
+    // Timings of recent hover updates, shown in the performance panel.
+    // The panel is redrawn by perfTimer rather than on every update, so
+    // that it does not add to the latency it is measuring.
+    PerfWindow                      walkTimes[3];   // Straight, vis, pivot.
+    PerfWindow                      locateTimes;
+    PerfWindow                      updateTimes;
+    PerfWindow                      pickBufferTimes;
+    QLabel*                         perfPanel;
+    QTimer*                         perfTimer;
+
+    // While a session is reopened, its state waits here and a picture of
+    // the view stands in for the scene until the triangulation is read.
+    QString                         sessionFile;
+    SessionState*                   restoring;
+    QGraphicsPixmapItem*            preview;
+    QFutureWatcher<bool>            sessionWriter;
      
     // When we are taking points as input we use the following.
     // if inputPoints < 0 we are not learning points..
@@ -0,0 +1,167 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Throughput of nearest vertex queries by walking, against a kd-tree.
+******************************************************************************/
+
+#include <iostream>
+#include <boost/format.hpp>
+
+#include <CGAL/Search_traits_2.h>
+#include <CGAL/Search_traits_adapter.h>
+#include <CGAL/Orthogonal_k_neighbor_search.h>
+#include <CGAL/property_map.h>
+
+#include "benchmark.h"
+#include "grid_index.h"
+#include "nearest_query.h"
+
+/*****************************************************************************/
+
+typedef Delaunay::Vertex_handle                         Vertex_handle;
+typedef std::pair<Point, Vertex_handle>                 Point_with_vertex;
+typedef CGAL::Search_traits_adapter<
+            Point_with_vertex,
+            CGAL::First_of_pair_property_map<Point_with_vertex>,
+            CGAL::Search_traits_2<K> >                  Traits;
+typedef CGAL::Orthogonal_k_neighbor_search<Traits>      Neighbor_search;
+typedef Neighbor_search::Tree                           Tree;
+
+/*****************************************************************************/
+
+// Exact k nearest neighbour search in the kd-tree for a chunk of queries.
+struct KdTreeQuery
+{
+    const Tree*                     tree;
+    const Point*                    queries;
+    int                             k;
+    Vertex_handle*                  results;
+
+    void operator()(int, int begin, int end)
+    {
+        for (int i=begin; i<end; i++)
+        {
+            Neighbor_search search(*tree, queries[i], k, 0);
+
+            Vertex_handle* r = results + (long long)i*k;
+            for (Neighbor_search::iterator it = search.begin();
+                 it != search.end(); ++it)
+                *r++ = it->first.second;
+        }
+    }
+};
+
+/*****************************************************************************/
+
+static void printRow(const char* method, int n, int k, double ms,
+                     int queries, double visited, const char* same)
+{
+    double q = qMax(1, queries);
+
+    std::cout << boost::format("%-12s %10d %4d %10.1f %10.2f %9s\n")
+                 % method % n % k % (ms * 1e6 / q) % (visited / q) % same;
+}
+
+/*****************************************************************************/
+
+template <typename W>
+static void walkRow(const char*                       method,
+                    Delaunay*                         dt,
+                    GridIndex<Delaunay>*              grid,
+                    const std::vector<Point>&         queries,
+                    int                               k,
+                    const std::vector<Vertex_handle>& reference)
+{
+    std::vector<Vertex_handle> results;
+
+    QElapsedTimer timer;
+    timer.start();
+    long long visited = parallelNearest<W>(dt, queries, k, results, grid);
+    double    ms      = timer.nsecsElapsed() / 1e6;
+
+    printRow(method, dt->number_of_vertices(), k, ms, queries.size(),
+             visited, results == reference ? "yes" : "no");
+}
+
+/*****************************************************************************/
+
+// Find the k nearest vertices to random points, by walking from a grid
+// index and expanding, and with an exact search in a kd-tree built on the
+// same vertices. Both run as parallel batches over the thread pool. The
+// walks must find exactly the vertices the kd-tree finds.
+//
+//  --nearest        Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --k              Comma separated list of numbers of neighbours.
+//  --queries        Number of queries.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+int runNearestBenchmark(const QStringList& args)
+{
+    QList<int>   sizes   = argIntList(args, "--n", "10000,100000,1000000");
+    QList<int>   ks      = argIntList(args, "--k", "1,8,32");
+    QList<int>   dists   = argDistributions(args);
+    int          queries = argValue(args, "--queries", "100000").toInt();
+    unsigned int seed    = argValue(args, "--seed",    "1"     ).toUInt();
+    int          dist    = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-12s %10s %4s %10s %10s %9s\n")
+                 % "method" % "n" % "k" % "ns/query" % "visited" % "same";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        Delaunay dt;
+        buildTriangulation(&dt, dist, sizes[s], seed);
+
+        std::vector<Point> targets;
+        generatePoints(dist, queries, seed + 1, targets);
+        if (targets.empty())
+            continue;
+
+        QElapsedTimer timer;
+        timer.start();
+        GridIndex<Delaunay> grid(&dt);
+        double gridMs = timer.nsecsElapsed() / 1e6;
+
+        std::vector<Point_with_vertex> points;
+        Delaunay::Finite_vertices_iterator v;
+        for (v = dt.finite_vertices_begin(); v != dt.finite_vertices_end(); ++v)
+            points.push_back(Point_with_vertex(v->point(), v));
+
+        timer.start();
+        Tree tree(points.begin(), points.end());
+        tree.build();
+        double treeMs = timer.nsecsElapsed() / 1e6;
+
+        std::cout << boost::format("# grid built in %.1f ms, "
+                                   "kd-tree built in %.1f ms\n")
+                     % gridMs % treeMs;
+
+        for (int i=0; i<ks.size(); i++)
+        {
+            int k = ks[i];
+            std::vector<Vertex_handle> reference(targets.size() * k);
+
+            KdTreeQuery query;
+            query.tree    = &tree;
+            query.queries = &targets[0];
+            query.k       = k;
+            query.results = &reference[0];
+
+            timer.start();
+            parallelChunks(targets.size(), NEAREST_BATCH_SIZE, query);
+            printRow("kd-tree", sizes[s], k, timer.nsecsElapsed() / 1e6,
+                     targets.size(), 0, "-");
+
+            walkRow< VisibilityWalk<Delaunay> >
+                ("visibility", &dt, &grid, targets, k, reference);
+            walkRow< PivotWalk<Delaunay> >
+                ("pivot",      &dt, &grid, targets, k, reference);
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,263 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Nearest and k nearest vertex queries, by walking and then expanding.
+*
+* A walk finds the face containing the query point, and the closest vertex
+* of that face is a good first guess. In a Delaunay triangulation every
+* vertex other than the nearest has a neighbour closer to the query (shrink
+* the disk about the query through it towards the vertex until it touches
+* another one: that is an empty circle, so an edge). So walking greedily to
+* closer neighbours ends at the nearest vertex, and expanding best first
+* from there over the edges finds the vertices in order of distance. The
+* expansion stops after k vertices, so the queue stays small.
+*
+******************************************************************************/
+
+#ifndef NEAREST_QUERY_H
+#define NEAREST_QUERY_H
+
+/*****************************************************************************/
+
+#include <vector>
+#include <functional>
+#include <algorithm>
+#include <boost/unordered_set.hpp>
+
+#include "walk.h"
+#include "parallel.h"
+
+/*****************************************************************************/
+
+// Queries per batch when running batches in parallel.
+const int NEAREST_BATCH_SIZE = 1024;
+
+/*****************************************************************************/
+
+// The walk W must end in the face containing its target, as the visibility
+// and pivot walks do. The straight walk runs on past its target, so the
+// results are still exact but the expansion starts far away.
+template <typename T, typename W = VisibilityWalk<T> >
+class NearestQuery
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+    typedef typename T::Vertex_circulator               Vertex_circulator;
+
+    // A vertex waiting to be expanded, with its squared distance.
+    typedef std::pair<double, Vertex_handle>            Candidate;
+
+public:
+    NearestQuery(T* dt) : dt(dt), numVisited(0), numOrientations(0) {}
+
+    /*************************************************************************/
+
+    // The vertex nearest to p. The walk starts from the face given by the
+    // oracle, or from the infinite face without one.
+    Vertex_handle nearest(const Point&        p,
+                          StartFaceOracle<T>* oracle = 0,
+                          unsigned int        seed   = 0)
+    {
+        Vertex_handle v = closestVertex(p, locate(p, oracle, seed));
+        if (v == Vertex_handle())
+            return v;
+
+        double d = CGAL::squared_distance(p, v->point());
+
+        for (bool moved=true; moved; )
+        {
+            moved = false;
+
+            Vertex_circulator c = dt->incident_vertices(v), done(c);
+            do {
+                numVisited++;
+                if (dt->is_infinite(c))
+                    continue;
+
+                double e = CGAL::squared_distance(p, c->point());
+                if (e < d)
+                {
+                    v     = c;
+                    d     = e;
+                    moved = true;
+                    break;
+                }
+            } while (++c != done);
+        }
+
+        return v;
+    }
+
+    /*************************************************************************/
+
+    // The k vertices nearest to p, nearest first, appended to out. Fewer
+    // are returned if the triangulation has fewer than k vertices.
+    void kNearest(const Point&                  p,
+                  int                           k,
+                  std::vector<Vertex_handle>&   out,
+                  StartFaceOracle<T>*           oracle = 0,
+                  unsigned int                  seed   = 0)
+    {
+        Vertex_handle v = nearest(p, oracle, seed);
+        if (v == Vertex_handle() || k <= 0)
+            return;
+
+        // The scratch space is kept between queries, clearing keeps the
+        // memory.
+        queue.clear();
+        seen.clear();
+
+        seen.insert(&*v);
+        push(p, v);
+
+        for (int found=0; found < k && !queue.empty(); found++)
+        {
+            std::pop_heap(queue.begin(), queue.end(),
+                          std::greater<Candidate>());
+            v = queue.back().second;
+            queue.pop_back();
+            out.push_back(v);
+
+            Vertex_circulator c = dt->incident_vertices(v), done(c);
+            do {
+                if (!dt->is_infinite(c) && seen.insert(&*c).second)
+                    push(p, c);
+            } while (++c != done);
+        }
+    }
+
+    /*************************************************************************/
+
+    // Work done by all queries so far: neighbours looked at, and
+    // orientations performed by the walks.
+    long long getNumVisited()      const { return numVisited;      }
+    long long getNumOrientations() const { return numOrientations; }
+
+private:
+    /*************************************************************************/
+
+    Face_handle locate(const Point& p, StartFaceOracle<T>* oracle,
+                       unsigned int seed)
+    {
+        Face_handle f = oracle ? oracle->startFace(p) : Face_handle();
+        W w(p, dt, f, seed);
+        numOrientations += w.getNumOrientationsPerformed();
+
+        f = w.getTrace().back();
+        return f == Face_handle() ? dt->infinite_face() : f;
+    }
+
+    // The finite vertex of f closest to p.
+    Vertex_handle closestVertex(const Point& p, Face_handle f)
+    {
+        Vertex_handle best;
+        double        d = 0;
+
+        for (int i=0; i<3; i++)
+        {
+            Vertex_handle v = f->vertex(i);
+            if (dt->is_infinite(v))
+                continue;
+
+            double e = CGAL::squared_distance(p, v->point());
+            if (best == Vertex_handle() || e < d)
+            {
+                best = v;
+                d    = e;
+            }
+        }
+        return best;
+    }
+
+    void push(const Point& p, Vertex_handle v)
+    {
+        numVisited++;
+        queue.push_back(Candidate(CGAL::squared_distance(p, v->point()), v));
+        std::push_heap(queue.begin(), queue.end(), std::greater<Candidate>());
+    }
+
+    T*                              dt;
+    long long                       numVisited;
+    long long                       numOrientations;
+
+    // Scratch space for kNearest(), reused by each query.
+    std::vector<Candidate>          queue;
+    boost::unordered_set<const void*> seen;
+};
+
+/******************************************************************************
+* Run a batch of queries on the thread pool. Each batch has its own query
+* object, so the scratch space is reused across the queries of a batch and
+* never shared between threads.
+******************************************************************************/
+
+template <typename T, typename W>
+struct NearestBatchRunner
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+
+    T*                              dt;
+    StartFaceOracle<T>*             oracle;
+    const Point*                    queries;
+    int                             k;
+    Vertex_handle*                  results;    // k per query.
+    long long*                      visited;    // One per batch.
+
+    void operator()(int chunk, int begin, int end)
+    {
+        NearestQuery<T,W>          query(dt);
+        std::vector<Vertex_handle> found;
+
+        for (int i=begin; i<end; i++)
+        {
+            found.clear();
+            query.kNearest(queries[i], k, found, oracle, i);
+            std::copy(found.begin(), found.end(), results + (long long)i*k);
+        }
+
+        visited[chunk] = query.getNumVisited();
+    }
+};
+
+/*****************************************************************************/
+
+// The k nearest vertices of each query, nearest first, k to a query in
+// results. Queries with fewer than k results are padded with null handles.
+// The oracle is shared by all threads, so it must be safe to read
+// concurrently. Returns the number of neighbours looked at.
+template <typename W, typename T>
+long long parallelNearest(T*                                        dt,
+                          const std::vector<typename T::Point>&     queries,
+                          int                                       k,
+                          std::vector<typename T::Vertex_handle>&   results,
+                          StartFaceOracle<T>*                       oracle = 0)
+{
+    results.assign(queries.size() * k, typename T::Vertex_handle());
+    if (queries.empty() || k <= 0)
+        return 0;
+
+    int n = queries.size();
+    std::vector<long long> visited((n + NEAREST_BATCH_SIZE - 1)
+                                                / NEAREST_BATCH_SIZE, 0);
+
+    NearestBatchRunner<T,W> runner;
+    runner.dt      = dt;
+    runner.oracle  = oracle;
+    runner.queries = &queries[0];
+    runner.k       = k;
+    runner.results = &results[0];
+    runner.visited = &visited[0];
+    parallelChunks(n, NEAREST_BATCH_SIZE, runner);
+
+    long long total = 0;
+    for (unsigned int b=0; b<visited.size(); b++)
+        total += visited[b];
+    return total;
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,383 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Memory nodes, thread pinning and page placement, and a benchmark of batch
+* locate on shared and replicated snapshots.
+*
+* The node layout comes from /sys/devices/system/node, threads are pinned
+* with sched_setaffinity() and the node of a page is asked for with
+* move_pages(), which with no target nodes only reports where pages are.
+* These are Linux only; elsewhere there is one node and nothing is pinned.
+*
+******************************************************************************/
+
+#include <algorithm>
+#include <iostream>
+#include <boost/format.hpp>
+
+#include <QDir>
+#include <QFile>
+
+#ifdef __linux__
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#endif
+
+#include "numa_locate.h"
+#include "benchmark.h"
+
+/*****************************************************************************/
+
+// CPUs this process is allowed to run on.
+static QList<int> allowedCpus()
+{
+    QList<int> cpus;
+
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+        for (int i=0; i<CPU_SETSIZE; i++)
+            if (CPU_ISSET(i, &set))
+                cpus.append(i);
+#endif
+
+    if (cpus.isEmpty())
+        for (int i=0; i<QThread::idealThreadCount(); i++)
+            cpus.append(i);
+
+    return cpus;
+}
+
+/*****************************************************************************/
+
+// Parse a kernel CPU list such as "0-3,8-11".
+static QList<int> parseCpuList(const QString& text)
+{
+    QList<int>  cpus;
+    QStringList ranges = text.trimmed().split(',', QString::SkipEmptyParts);
+
+    for (int i=0; i<ranges.size(); i++)
+    {
+        QStringList ends = ranges[i].split('-');
+        bool        ok1  = false, ok2 = false;
+        int         lo   = ends[0].toInt(&ok1);
+        int         hi   = ends.size() > 1 ? ends[1].toInt(&ok2) : lo;
+
+        if (ok1 && (ends.size() == 1 || ok2))
+            for (int c=lo; c<=hi; c++)
+                cpus.append(c);
+    }
+
+    return cpus;
+}
+
+/*****************************************************************************/
+
+static bool nodeLessThan(const NumaNode& a, const NumaNode& b)
+{
+    return a.id < b.id;
+}
+
+/*****************************************************************************/
+
+QList<NumaNode> numaNodes()
+{
+    QList<int>      allowed = allowedCpus();
+    QList<NumaNode> nodes;
+
+    QDir        dir("/sys/devices/system/node");
+    QStringList entries = dir.entryList(QStringList("node*"), QDir::Dirs);
+
+    for (int i=0; i<entries.size(); i++)
+    {
+        NumaNode node;
+        bool     ok;
+        node.id = entries[i].mid(4).toInt(&ok);
+        if (!ok)
+            continue;
+
+        QFile file(dir.filePath(entries[i] + "/cpulist"));
+        if (!file.open(QIODevice::ReadOnly))
+            continue;
+
+        QList<int> cpus = parseCpuList(QString(file.readAll()));
+        for (int c=0; c<cpus.size(); c++)
+            if (allowed.contains(cpus[c]))
+                node.cpus.append(cpus[c]);
+
+        // Nodes with memory only, or only CPUs we may not use.
+        if (!node.cpus.isEmpty())
+            nodes.append(node);
+    }
+
+    if (nodes.isEmpty())
+    {
+        NumaNode node;
+        node.id   = 0;
+        node.cpus = allowed;
+        nodes.append(node);
+    }
+
+    std::sort(nodes.begin(), nodes.end(), nodeLessThan);
+    return nodes;
+}
+
+/*****************************************************************************/
+
+QList<NumaNode> simulateNumaNodes(const QList<NumaNode>& nodes, int count)
+{
+    if (count <= nodes.size())
+        return nodes;
+
+    QList<int> cpus, ids;
+    for (int i=0; i<nodes.size(); i++)
+        for (int c=0; c<nodes[i].cpus.size(); c++)
+        {
+            cpus.append(nodes[i].cpus[c]);
+            ids.append(nodes[i].id);
+        }
+
+    // Never more groups than CPUs, every group needs one.
+    count = qMin(count, cpus.size());
+    if (count <= nodes.size())
+        return nodes;
+
+    QList<NumaNode> groups;
+    for (int k=0; k<count; k++)
+    {
+        int begin = cpus.size() *  k    / count;
+        int end   = cpus.size() * (k+1) / count;
+
+        NumaNode group;
+        group.id   = ids[begin];
+        group.cpus = cpus.mid(begin, end - begin);
+        groups.append(group);
+    }
+
+    return groups;
+}
+
+/*****************************************************************************/
+
+bool pinThread(const QList<int>& cpus)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int i=0; i<cpus.size(); i++)
+        if (cpus[i] >= 0 && cpus[i] < CPU_SETSIZE)
+            CPU_SET(cpus[i], &set);
+
+    return !cpus.isEmpty() && sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    Q_UNUSED(cpus);
+    return false;
+#endif
+}
+
+/*****************************************************************************/
+
+std::vector<long long> pageNodes(const void* data, size_t bytes)
+{
+    std::vector<long long> counts;
+
+#if defined(__linux__) && defined(SYS_move_pages)
+    if (!data || bytes == 0)
+        return counts;
+
+    quintptr size   = sysconf(_SC_PAGESIZE);
+    quintptr first  = (quintptr)data / size;
+    quintptr last   = ((quintptr)data + bytes - 1) / size;
+    quintptr stride = std::max<quintptr>(1, (last - first + 1)
+                                            / NUMA_PAGE_SAMPLES);
+
+    std::vector<void*> pages;
+    for (quintptr p=first; p<=last; p+=stride)
+        pages.push_back((void*)(p * size));
+
+    // With no target nodes, move_pages() moves nothing and writes the
+    // node of each page into status, or a negative error.
+    std::vector<int> status(pages.size(), -1);
+    if (syscall(SYS_move_pages, 0, pages.size(), &pages[0], (const int*)0,
+                &status[0], 0) != 0)
+        return counts;
+
+    for (unsigned int i=0; i<status.size(); i++)
+    {
+        if (status[i] < 0)
+            continue;
+
+        if (status[i] >= (int)counts.size())
+            counts.resize(status[i] + 1, 0);
+        counts[status[i]]++;
+    }
+#else
+    Q_UNUSED(data);
+    Q_UNUSED(bytes);
+#endif
+
+    return counts;
+}
+
+/*****************************************************************************/
+
+static QString cpuListString(const QList<int>& cpus)
+{
+    QStringList ranges;
+    for (int i=0; i<cpus.size(); )
+    {
+        int j = i;
+        while (j+1 < cpus.size() && cpus[j+1] == cpus[j] + 1)
+            j++;
+
+        ranges.append(j > i ? QString("%1-%2").arg(cpus[i]).arg(cpus[j])
+                            : QString::number(cpus[i]));
+        i = j + 1;
+    }
+    return ranges.join(",");
+}
+
+/*****************************************************************************/
+
+// Locate the batch with one snapshot per node or one shared snapshot, and
+// print a row per node and a total. Leaves the faces found in faces and the
+// queries per microsecond in rate, and returns the bytes read from other
+// nodes.
+static long long numaRows(const char*                     mode,
+                          Delaunay*                       dt,
+                          const QList<NumaNode>&          nodes,
+                          bool                            replicate,
+                          int                             threads,
+                          const std::vector<Point>&       targets,
+                          const std::vector<Face_handle>& starts,
+                          std::vector<Face_handle>&       faces,
+                          double&                         rate)
+{
+    ReplicatedLocator<Delaunay> locator(dt, nodes, replicate);
+    locator.locate(targets, starts, faces, threads);
+
+    const std::vector<NumaNodeStats>& stats = locator.statistics();
+
+    long long queries = 0, bytes = 0, remote = 0;
+    double    ns      = 0;
+    bool      pinned  = true;
+
+    for (unsigned int k=0; k<stats.size(); k++)
+    {
+        const NumaNodeStats& s = stats[k];
+
+        QString local = s.localPages < 0
+                      ? QString("-")
+                      : QString::number(100 * s.localPages, 'f', 1);
+
+        std::cout << boost::format("%-10s %10d %4d %4d %7d %6s %9.2f "
+                                   "%10.1f %10.1f %8s\n")
+                     % mode % dt->number_of_vertices() % k % s.node
+                     % s.threads % (s.pinned ? "yes" : "no")
+                     % (s.queries / qMax(1.0, s.ns) * 1e3)
+                     % (s.bytes / 1e6) % (s.remoteBytes / 1e6)
+                     % local.toStdString();
+
+        queries += s.queries;
+        bytes   += s.bytes;
+        remote  += s.remoteBytes;
+        ns       = std::max(ns, s.ns);
+        pinned   = pinned && s.pinned;
+    }
+
+    rate = queries / qMax(1.0, ns) * 1e3;
+
+    std::cout << boost::format("%-10s %10d %4s %4s %7s %6s %9.2f "
+                               "%10.1f %10.1f %8.1f\n")
+                 % mode % dt->number_of_vertices() % "all" % "-"
+                 % "-" % (pinned ? "yes" : "no") % rate
+                 % (bytes / 1e6) % (remote / 1e6) % (locator.bytes() / 1e6);
+
+    return remote;
+}
+
+/*****************************************************************************/
+
+// Time a parallel batch locate on compact snapshots, first shared by every
+// node and then replicated on each, with threads pinned to their node.
+//
+//  --numa           Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --queries        Number of queries per size.
+//  --nodes          Simulate this many nodes by splitting the CPUs, if the
+//                   machine has fewer. Defaults to 2 on a single node.
+//  --threads        Threads per node, 0 for one per CPU.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+//
+// Rows give the node's throughput in millions of queries per second, and
+// the megabytes of snapshot it read, from any node and from other nodes.
+// The last column is the percentage of the node's snapshot pages that the
+// kernel reports on the node, and on the total row the megabytes of all the
+// snapshots. Remote reads are counted by where each snapshot was built, so
+// on simulated nodes they show what would be remote, not what was.
+int runNumaBenchmark(const QStringList& args)
+{
+    QList<int>   sizes   = argIntList(args, "--n", "1000000,4000000");
+    QList<int>   dists   = argDistributions(args);
+    int          queries = argValue(args, "--queries", "1000000").toInt();
+    int          threads = argValue(args, "--threads", "0"      ).toInt();
+    unsigned int seed    = argValue(args, "--seed",    "1"      ).toUInt();
+    int          dist    = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+
+    QList<NumaNode> real  = numaNodes();
+    int             count = argValue(args, "--nodes",
+                                     real.size() > 1 ? "0" : "2").toInt();
+    QList<NumaNode> nodes = simulateNumaNodes(real, count);
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%d memory node(s)%s\n")
+                 % real.size()
+                 % (nodes.size() > real.size() ? ", simulated as:" : ":");
+    for (int k=0; k<nodes.size(); k++)
+        std::cout << boost::format("  node %d (memory %d): cpus %s\n")
+                     % k % nodes[k].id
+                     % cpuListString(nodes[k].cpus).toStdString();
+
+    std::cout << boost::format("%-10s %10s %4s %4s %7s %6s %9s "
+                               "%10s %10s %8s\n")
+                 % "snapshot" % "n" % "node" % "mem" % "threads" % "pinned"
+                 % "Mq/s" % "MB read" % "remote MB" % "local %";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        Delaunay dt;
+        buildTriangulation(&dt, dist, sizes[s], seed);
+
+        std::vector<Point>       targets;
+        std::vector<Face_handle> starts;
+        makeQueries(&dt, dist, queries, seed, targets, starts);
+
+        std::vector<Face_handle> shared, replicated;
+        double                   sharedRate, replicatedRate;
+
+        long long before = numaRows("shared", &dt, nodes, false, threads,
+                                    targets, starts, shared, sharedRate);
+        long long after  = numaRows("replicated", &dt, nodes, true, threads,
+                                    targets, starts, replicated,
+                                    replicatedRate);
+
+        // Every snapshot is a copy of the same one, and the walks make the
+        // same choices on each, so the faces must agree.
+        bool same = shared == replicated;
+
+        std::cout << boost::format("n = %d: remote MB %.1f -> %.1f "
+                                   "(%.1f%% less), throughput x%.2f, "
+                                   "same faces: %s\n")
+                     % sizes[s] % (before / 1e6) % (after / 1e6)
+                     % (before > 0 ? 100.0 * (before - after) / before : 0.0)
+                     % (replicatedRate / qMax(1e-9, sharedRate))
+                     % (same ? "yes" : "no");
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,374 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Batch locate on compact snapshots replicated per memory node.
+*
+* On a machine with several memory (NUMA) nodes, threads walking one shared
+* triangulation read most of it from another node's memory. Here each node
+* gets its own compact snapshot, copied by a thread pinned to the node so
+* that the kernel places the pages there when they are first written. A
+* batch is split into one range per node, walked by threads pinned to that
+* node on its own snapshot.
+*
+* On a machine with one node, nodes can be simulated by splitting its CPUs
+* into groups. Threads are still pinned to the groups, but all memory is
+* local, so only the bookkeeping of remote reads is meaningful.
+*
+******************************************************************************/
+
+#ifndef NUMA_LOCATE_H
+#define NUMA_LOCATE_H
+
+/*****************************************************************************/
+
+#include <vector>
+#include <algorithm>
+
+#include <QList>
+#include <QThread>
+#include <QElapsedTimer>
+
+#include "compact_triangulation.h"
+
+/*****************************************************************************/
+
+// Most pages of an array asked about by pageNodes().
+const int NUMA_PAGE_SAMPLES = 4096;
+
+/*****************************************************************************/
+
+// A memory node and the CPUs of it this process may run on.
+struct NumaNode
+{
+    int                             id;
+    QList<int>                      cpus;
+};
+
+// The nodes in /sys/devices/system/node that have CPUs in the affinity
+// mask of this process, by id. If there are none, one node 0 holding every
+// allowed CPU.
+QList<NumaNode>         numaNodes();
+
+// Split the CPUs of the nodes into count groups of nearly equal size, in
+// order. A group keeps the id of the node its first CPU is on. Returns the
+// nodes unchanged if there are already count of them or more.
+QList<NumaNode>         simulateNumaNodes(const QList<NumaNode>& nodes,
+                                          int                    count);
+
+// Restrict the calling thread to the given CPUs. False if this is not
+// supported or the kernel refused.
+bool                    pinThread(const QList<int>& cpus);
+
+// The number of pages of [data, data + bytes) on each node, indexed by node
+// id, from a sample of at most NUMA_PAGE_SAMPLES pages. Empty if the kernel
+// will not say where pages are.
+std::vector<long long>  pageNodes(const void* data, size_t bytes);
+
+/*****************************************************************************/
+
+// The share of a batch walked on one node.
+struct NumaNodeStats
+{
+    int                             node;           // Id of the memory node.
+    int                             threads;
+    bool                            pinned;         // All threads pinned.
+    long long                       queries;
+    double                          ns;             // Wall time for the share.
+    long long                       bytes;          // Snapshot bytes read.
+    long long                       remoteBytes;    // From another node.
+    double                          localPages;     // Fraction, -1 if unknown.
+};
+
+/*****************************************************************************/
+
+template <typename T, typename C = FloatCoordinates>
+class ReplicatedLocator
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef CompactTriangulation<T, C>                  Snapshot;
+
+    // Runs on the CPUs of one node. Builds the node's snapshot if dt is
+    // set, and otherwise walks a range of a batch on it.
+    class NodeThread : public QThread
+    {
+    public:
+        const NumaNode*             node;
+        const Snapshot*             source;     // Copy this, or dt if null.
+        T*                          dt;
+        Snapshot*                   built;
+
+        const Snapshot*             snapshot;
+        const Point*                targets;
+        const int*                  from;
+        int*                        to;
+        int                         begin;
+        int                         end;
+
+        bool                        pinned;
+        double                      ns;
+        CompactWalkCounters         counters;
+
+    protected:
+        void run()
+        {
+            pinned = pinThread(node->cpus);
+
+            if (dt)
+            {
+                built = source ? new Snapshot(*source) : new Snapshot(dt);
+                return;
+            }
+
+            CompactWalkCounters c = {0, 0, 0, 0};
+
+            QElapsedTimer timer;
+            timer.start();
+            for (int i=begin; i<end; i++)
+                to[i] = snapshot->locate(targets[i], from[i], i, c);
+            ns = timer.nsecsElapsed();
+
+            counters = c;
+        }
+    };
+
+public:
+    // Snapshot dt once per node, or once on the first node for all of them
+    // if not replicating.
+                                    ReplicatedLocator(
+                                        T*                     dt,
+                                        const QList<NumaNode>& nodes,
+                                        bool                   replicate);
+                                   ~ReplicatedLocator();
+
+    // Locate each target starting from the face of the same index, leaving
+    // the results in faces. Each node walks an equal range of the batch
+    // with the given number of threads, or one per CPU if 0.
+    void        locate(const std::vector<Point>&       targets,
+                       const std::vector<Face_handle>& starts,
+                       std::vector<Face_handle>&       faces,
+                       int                             threadsPerNode=0);
+
+    // Per node figures for the last batch.
+    const std::vector<NumaNodeStats>& statistics() const { return stats; }
+
+    // Memory used by the snapshots.
+    size_t                          bytes() const;
+
+private:
+    NodeThread*                     newThread(int node);
+    double                          localPages(int node) const;
+
+    T*                              dt;
+    QList<NumaNode>                 nodes;
+
+    // One per node. Without replication they all share the first, which
+    // is home to the first node.
+    std::vector<Snapshot*>          snapshots;
+    std::vector<int>                homes;
+    std::vector<NumaNodeStats>      stats;
+};
+
+/*****************************************************************************/
+
+template <typename T, typename C>
+ReplicatedLocator<T,C>::ReplicatedLocator(T*                     dt,
+                                          const QList<NumaNode>& nodes,
+                                          bool                   replicate)
+{
+    this->dt    = dt;
+    this->nodes = nodes;
+
+    if (this->nodes.isEmpty())
+        this->nodes = numaNodes();
+
+    int count = this->nodes.size();
+    snapshots = std::vector<Snapshot*>(count, (Snapshot*)0);
+    homes     = std::vector<int>(count, 0);
+
+    // The first snapshot is built from the triangulation, the others are
+    // copies of it, which is cheaper than going through the triangulation
+    // again. The copying threads are the first to write their pages.
+    NodeThread* first = newThread(0);
+    first->start();
+    first->wait();
+    snapshots[0] = first->built;
+    delete first;
+
+    for (int i=1; i<count; i++)
+        snapshots[i] = snapshots[0];
+
+    if (!replicate)
+        return;
+
+    std::vector<NodeThread*> threads;
+    for (int i=1; i<count; i++)
+    {
+        threads.push_back(newThread(i));
+        threads.back()->source = snapshots[0];
+        threads.back()->start();
+    }
+
+    for (int i=1; i<count; i++)
+    {
+        threads[i-1]->wait();
+        snapshots[i] = threads[i-1]->built;
+        homes[i]     = i;
+        delete threads[i-1];
+    }
+}
+
+/*****************************************************************************/
+
+template <typename T, typename C>
+ReplicatedLocator<T,C>::~ReplicatedLocator()
+{
+    for (unsigned int i=0; i<snapshots.size(); i++)
+        if (homes[i] == (int)i)
+            delete snapshots[i];
+}
+
+/*****************************************************************************/
+
+template <typename T, typename C>
+typename ReplicatedLocator<T,C>::NodeThread*
+ReplicatedLocator<T,C>::newThread(int node)
+{
+    NodeThread* t = new NodeThread;
+    t->node     = &nodes[node];
+    t->source   = 0;
+    t->dt       = dt;
+    t->built    = 0;
+    t->snapshot = 0;
+    t->targets  = 0;
+    t->from     = 0;
+    t->to       = 0;
+    t->begin    = 0;
+    t->end      = 0;
+    t->pinned   = false;
+    t->ns       = 0;
+    return t;
+}
+
+/*****************************************************************************/
+
+template <typename T, typename C>
+size_t ReplicatedLocator<T,C>::bytes() const
+{
+    size_t b = 0;
+    for (unsigned int i=0; i<snapshots.size(); i++)
+        if (homes[i] == (int)i)
+            b += snapshots[i]->bytes();
+    return b;
+}
+
+/*****************************************************************************/
+
+// Fraction of the pages of the node's snapshot that are on the node.
+template <typename T, typename C>
+double ReplicatedLocator<T,C>::localPages(int node) const
+{
+    const Snapshot* s = snapshots[node];
+
+    std::vector<long long> a = pageNodes(s->faceArray(),   s->faceBytes());
+    std::vector<long long> b = pageNodes(s->vertexArray(), s->vertexBytes());
+
+    long long local = 0, total = 0;
+    for (unsigned int i=0; i<std::max(a.size(), b.size()); i++)
+    {
+        long long c = (i < a.size() ? a[i] : 0) + (i < b.size() ? b[i] : 0);
+        total += c;
+        if ((int)i == nodes[node].id)
+            local += c;
+    }
+
+    return total > 0 ? local / (double)total : -1;
+}
+
+/*****************************************************************************/
+
+template <typename T, typename C>
+void ReplicatedLocator<T,C>::locate(
+                                const std::vector<Point>&       targets,
+                                const std::vector<Face_handle>& starts,
+                                std::vector<Face_handle>&       faces,
+                                int                             threadsPerNode)
+{
+    int n     = targets.size();
+    int count = nodes.size();
+
+    // Face indices are the same in every snapshot. Convert here, looking
+    // up an index can write to the hash table.
+    std::vector<int> from(n), to(n);
+    for (int i=0; i<n; i++)
+        from[i] = snapshots[0]->indexOf(starts[i]);
+
+    // Start every thread before waiting on any, so that nodes walk at the
+    // same time and contend for memory as they would in use.
+    std::vector<NodeThread*> running;
+    std::vector<int>         owner;
+    for (int k=0; k<count; k++)
+    {
+        int begin = (long long)n *  k    / count;
+        int end   = (long long)n * (k+1) / count;
+        int t     = threadsPerNode > 0 ? threadsPerNode
+                                       : qMax(1, nodes[k].cpus.size());
+
+        for (int j=0; j<t; j++)
+        {
+            NodeThread* w = newThread(k);
+            w->dt       = 0;
+            w->snapshot = snapshots[k];
+            w->targets  = n > 0 ? &targets[0] : 0;
+            w->from     = n > 0 ? &from[0]    : 0;
+            w->to       = n > 0 ? &to[0]      : 0;
+            w->begin    = begin + (long long)(end - begin) *  j    / t;
+            w->end      = begin + (long long)(end - begin) * (j+1) / t;
+            w->start();
+
+            running.push_back(w);
+            owner.push_back(k);
+        }
+    }
+
+    stats = std::vector<NumaNodeStats>(count);
+    for (int k=0; k<count; k++)
+    {
+        NumaNodeStats& s = stats[k];
+        s.node        = nodes[k].id;
+        s.threads     = 0;
+        s.pinned      = true;
+        s.queries     = (long long)n * (k+1) / count
+                      - (long long)n *  k    / count;
+        s.ns          = 0;
+        s.bytes       = 0;
+        s.remoteBytes = 0;
+        s.localPages  = localPages(k);
+    }
+
+    for (unsigned int i=0; i<running.size(); i++)
+    {
+        NodeThread*    w = running[i];
+        NumaNodeStats& s = stats[owner[i]];
+        w->wait();
+
+        s.threads++;
+        s.pinned  = s.pinned && w->pinned;
+        s.ns      = std::max(s.ns, w->ns);
+        s.bytes  += w->counters.bytes;
+
+        if (homes[owner[i]] != owner[i])
+            s.remoteBytes += w->counters.bytes;
+
+        delete w;
+    }
+
+    faces.resize(n);
+    for (int i=0; i<n; i++)
+        faces[i] = snapshots[0]->face(to[i]);
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,70 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Small helpers to split independent work over the global Qt thread pool.
+******************************************************************************/
+
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+/*****************************************************************************/
+
+#include <QThread>
+#include <QFuture>
+#include <QList>
+#include <QtConcurrentRun>
+
+/******************************************************************************
+* A single chunk of work. The functor is called as f(chunk, begin, end).
+******************************************************************************/
+
+template <typename Functor>
+struct ChunkTask
+{
+    typedef void result_type;
+
+    Functor f;
+    int     chunk;
+    int     begin;
+    int     end;
+
+    void operator()() { f(chunk, begin, end); }
+};
+
+/*****************************************************************************/
+
+// Split [0,n) into chunks of chunkSize items and run them on the thread pool,
+// blocking until they are all done. Chunk boundaries depend only on n and
+// chunkSize, never on the number of threads, so a chunk index can be used to
+// derive deterministic per-chunk state such as a random seed.
+template <typename Functor>
+void parallelChunks(int n, int chunkSize, Functor f)
+{
+    QList< QFuture<void> > futures;
+
+    for (int chunk=0, begin=0; begin < n; chunk++, begin += chunkSize)
+    {
+        ChunkTask<Functor> task;
+        task.f     = f;
+        task.chunk = chunk;
+        task.begin = begin;
+        task.end   = qMin(begin + chunkSize, n);
+
+        // Don't pay for a thread when there is only one chunk.
+        if (task.end == n && chunk == 0)
+        {
+            task();
+            return;
+        }
+
+        futures.append(QtConcurrent::run(task));
+    }
+
+    for (int i=0; i<futures.size(); i++)
+        futures[i].waitForFinished();
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,558 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Parallel construction of a Delaunay triangulation.
+*
+* Each strip is triangulated on its own. A face of a strip triangulation
+* whose circumcircle lies strictly inside the strip is a face of the global
+* triangulation, since no point of another strip can be inside its circle.
+* These are the "safe" faces. Every other global face has all three of its
+* vertices on some unsafe face of a strip (or on the hull of a strip), so
+* the remaining faces are exactly those faces of the triangulation of these
+* seam vertices that do not overlap a safe face.
+*
+* The final triangulation is assembled directly in the data structure of an
+* empty Delaunay. Adjacency between safe faces is copied from the strips in
+* parallel, only the edges along the seams are matched by hashing.
+*
+******************************************************************************/
+
+#include <limits>
+#include <algorithm>
+#include <iostream>
+
+#include <boost/format.hpp>
+#include <boost/unordered_map.hpp>
+
+#include <QThreadPool>
+
+#include <CGAL/Interval_nt.h>
+#include <CGAL/Triangulation_vertex_base_with_info_2.h>
+#include <CGAL/Triangulation_face_base_with_info_2.h>
+
+#include "parallel_delaunay.h"
+#include "parallel.h"
+#include "benchmark.h"
+
+/*****************************************************************************/
+
+// Vertices remember the index of their input point, faces the index of the
+// face they became in the final triangulation (or -1 if they are unsafe).
+typedef CGAL::Triangulation_vertex_base_with_info_2<int,K>  Strip_vb;
+typedef CGAL::Triangulation_face_base_with_info_2<int,K>    Strip_fb;
+typedef CGAL::Triangulation_data_structure_2<Strip_vb,Strip_fb>
+                                                            Strip_tds;
+typedef CGAL::Delaunay_triangulation_2<K,Strip_tds>         Strip_dt;
+typedef Strip_dt::Face_handle                               Strip_face;
+typedef Strip_dt::Vertex_handle                             Strip_vertex;
+
+typedef Delaunay::Triangulation_data_structure              Tds;
+typedef Delaunay::Vertex_handle                             Vertex_handle;
+
+typedef std::pair<Point,int>                                Indexed_point;
+typedef boost::unordered_map<quint64, std::pair<Face_handle,int> >
+                                                            Edge_map;
+
+/*****************************************************************************/
+
+// A face edge that may need to be matched against a face from elsewhere,
+// given as the directed edge a->b of the face, counter-clockwise.
+struct OpenEdge
+{
+    Face_handle f;
+    int         i;
+    int         a;
+    int         b;
+};
+
+/*****************************************************************************/
+
+struct Strip
+{
+    // The strip owns points with lo <= x < hi.
+    double                          lo;
+    double                          hi;
+
+    std::vector<Indexed_point>      points;
+    Strip_dt*                       dt;
+
+    std::vector<Strip_face>         safe;
+    std::vector<int>                seam;
+    std::vector<OpenEdge>           border;
+};
+
+/*****************************************************************************/
+
+static quint64 edgeKey(int a, int b)
+{
+    return ((quint64)(quint32)a << 32) | (quint32)b;
+}
+
+/*****************************************************************************/
+
+// Is the circumcircle of f strictly inside the open slab (lo, hi)? The
+// circumcentre and radius are computed in interval arithmetic, and a face
+// is only called safe if that is certain. Anything else is unsafe, which
+// only makes the seams wider, so the answer is never wrong. The bounds are
+// input coordinates, or infinite for the outer strips.
+static bool isSafe(Strip_face f, double lo, double hi)
+{
+    typedef CGAL::Interval_nt<> Interval;
+
+    const Point& p = f->vertex(0)->point();
+    const Point& q = f->vertex(1)->point();
+    const Point& r = f->vertex(2)->point();
+
+    // Circumcentre relative to p, and the squared radius.
+    Interval bx = Interval(q.x()) - p.x(),  by = Interval(q.y()) - p.y();
+    Interval cx = Interval(r.x()) - p.x(),  cy = Interval(r.y()) - p.y();
+    Interval b2 = bx*bx + by*by,            c2 = cx*cx + cy*cy;
+    Interval d  = 2.0 * (bx*cy - by*cx);
+
+    // Division by an interval holding zero gives the whole line.
+    Interval ux = (cy*b2 - by*c2) / d;
+    Interval uy = (bx*c2 - cx*b2) / d;
+    Interval r2 = ux*ux + uy*uy;
+    Interval x  = ux + p.x();
+
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    // Certain when every value of one interval beats every value of the
+    // other.
+    bool left  = lo == -infinity
+              || (x.inf() > lo && CGAL::square(x - lo).inf() > r2.sup());
+    bool right = hi ==  infinity
+              || (x.sup() < hi && CGAL::square(hi - x).inf() > r2.sup());
+
+    return left && right;
+}
+
+/*****************************************************************************/
+
+// Triangulate strips and sort their faces into safe and unsafe.
+struct StripBuilder
+{
+    Strip* strips;
+
+    void operator()(int, int begin, int end)
+    {
+        for (int s=begin; s<end; s++)
+            build(strips[s]);
+    }
+
+    void build(Strip& strip)
+    {
+        Strip_dt* dt = strip.dt = new Strip_dt();
+        dt->insert(strip.points.begin(), strip.points.end());
+
+        // A degenerate strip is left entirely to the seam triangulation.
+        if (dt->dimension() < 2)
+        {
+            Strip_dt::Finite_vertices_iterator v;
+            for (v=dt->finite_vertices_begin();
+                 v!=dt->finite_vertices_end(); ++v)
+                strip.seam.push_back(v->info());
+            return;
+        }
+
+        Strip_dt::All_faces_iterator f;
+        for (f=dt->all_faces_begin(); f!=dt->all_faces_end(); ++f)
+        {
+            if (!dt->is_infinite(f) && isSafe(f, strip.lo, strip.hi))
+            {
+                f->info() = 0;
+                strip.safe.push_back(f);
+                continue;
+            }
+
+            f->info() = -1;
+            for (int i=0; i<3; i++)
+                if (!dt->is_infinite(f->vertex(i)))
+                    strip.seam.push_back(f->vertex(i)->info());
+        }
+
+        std::sort(strip.seam.begin(), strip.seam.end());
+        strip.seam.erase(std::unique(strip.seam.begin(), strip.seam.end()),
+                         strip.seam.end());
+    }
+};
+
+/*****************************************************************************/
+
+// Copy adjacency between the safe faces of each strip into the final
+// triangulation. Every final face and vertex touched here belongs to a
+// single strip, so strips can be linked concurrently.
+struct StripLinker
+{
+    Strip*                          strips;
+    const Face_handle*              faces;
+    const Vertex_handle*            vertices;
+
+    void operator()(int, int begin, int end)
+    {
+        for (int s=begin; s<end; s++)
+            link(strips[s]);
+    }
+
+    void link(Strip& strip)
+    {
+        for (unsigned int k=0; k<strip.safe.size(); k++)
+        {
+            Strip_face  f = strip.safe[k];
+            Face_handle F = faces[f->info()];
+
+            for (int i=0; i<3; i++)
+            {
+                vertices[f->vertex(i)->info()]->set_face(F);
+
+                Strip_face g = f->neighbor(i);
+                if (g->info() >= 0)
+                {
+                    F->set_neighbor(i, faces[g->info()]);
+                    continue;
+                }
+
+                OpenEdge e;
+                e.f = F;
+                e.i = i;
+                e.a = f->vertex(Strip_dt::ccw(i))->info();
+                e.b = f->vertex(Strip_dt::cw(i))->info();
+                strip.border.push_back(e);
+            }
+        }
+    }
+};
+
+/*****************************************************************************/
+
+// Find a point strictly inside the triangle pqr, or return false if none of
+// the candidates survives rounding (only for extreme slivers).
+static bool interiorPoint(const Point& p,
+                          const Point& q,
+                          const Point& r,
+                          Point&       c)
+{
+    static const double weights[4][3] = { {1/3.0, 1/3.0, 1/3.0},
+                                          {0.5,   0.25,  0.25 },
+                                          {0.25,  0.5,   0.25 },
+                                          {0.25,  0.25,  0.5  } };
+    for (int w=0; w<4; w++)
+    {
+        c = Point(weights[w][0]*p.x() + weights[w][1]*q.x()
+                                      + weights[w][2]*r.x(),
+                  weights[w][0]*p.y() + weights[w][1]*q.y()
+                                      + weights[w][2]*r.y());
+
+        if (CGAL::orientation(p, q, c) == CGAL::LEFT_TURN &&
+            CGAL::orientation(q, r, c) == CGAL::LEFT_TURN &&
+            CGAL::orientation(r, p, c) == CGAL::LEFT_TURN)
+            return true;
+    }
+    return false;
+}
+
+/*****************************************************************************/
+
+// Build the triangulation into dt from strips that have already been
+// triangulated. Returns false if the seams could not be repaired.
+static bool assemble(Delaunay*                 dt,
+                     const std::vector<Point>& points,
+                     std::vector<Strip>&       strips,
+                     const std::vector<double>& splits)
+{
+    Tds&          tds      = dt->tds();
+    Vertex_handle infinite = dt->infinite_vertex();
+
+    // Create a vertex for every point that survived duplicate removal.
+    std::vector<Vertex_handle> vertices(points.size());
+    for (unsigned int s=0; s<strips.size(); s++)
+    {
+        Strip_dt::Finite_vertices_iterator v;
+        for (v=strips[s].dt->finite_vertices_begin();
+             v!=strips[s].dt->finite_vertices_end(); ++v)
+        {
+            vertices[v->info()] = tds.create_vertex();
+            vertices[v->info()]->set_point(v->point());
+        }
+    }
+
+    tds.set_dimension(2);
+
+    // Safe faces keep the vertex order of their strip, so that neighbour
+    // indices carry over unchanged.
+    std::vector<Face_handle> faces;
+    for (unsigned int s=0; s<strips.size(); s++)
+    {
+        for (unsigned int k=0; k<strips[s].safe.size(); k++)
+        {
+            Strip_face f = strips[s].safe[k];
+            f->info()    = faces.size();
+            faces.push_back(tds.create_face(vertices[f->vertex(0)->info()],
+                                            vertices[f->vertex(1)->info()],
+                                            vertices[f->vertex(2)->info()]));
+        }
+    }
+
+    if (!faces.empty())
+    {
+        StripLinker linker;
+        linker.strips   = &strips[0];
+        linker.faces    = &faces[0];
+        linker.vertices = &vertices[0];
+        parallelChunks(strips.size(), 1, linker);
+    }
+
+    // Triangulate the seam vertices.
+    std::vector<Indexed_point> seamPoints;
+    for (unsigned int s=0; s<strips.size(); s++)
+        for (unsigned int k=0; k<strips[s].seam.size(); k++)
+            seamPoints.push_back(Indexed_point(points[strips[s].seam[k]],
+                                               strips[s].seam[k]));
+
+    Strip_dt seam;
+    seam.insert(seamPoints.begin(), seamPoints.end());
+    if (seam.dimension() < 2)
+        return false;
+
+    // Keep the seam faces that are not covered by a safe face. Safe faces
+    // lie inside their own strip, so one point location in the strip that
+    // contains a point of the face is enough to tell.
+    std::vector<OpenEdge> open;
+    for (unsigned int s=0; s<strips.size(); s++)
+        open.insert(open.end(), strips[s].border.begin(),
+                                strips[s].border.end());
+
+    Strip_dt::Finite_faces_iterator g;
+    for (g=seam.finite_faces_begin(); g!=seam.finite_faces_end(); ++g)
+    {
+        Point c;
+        if (!interiorPoint(g->vertex(0)->point(), g->vertex(1)->point(),
+                           g->vertex(2)->point(), c))
+            return false;
+
+        int k = std::upper_bound(splits.begin(), splits.end(), c.x())
+                - splits.begin();
+
+        Strip_dt* dtk = strips[k].dt;
+        if (dtk->dimension() == 2)
+        {
+            Strip_face located = dtk->locate(c);
+            if (!dtk->is_infinite(located) && located->info() >= 0)
+                continue;
+        }
+
+        int         index[3];
+        for (int i=0; i<3; i++)
+            index[i] = g->vertex(i)->info();
+
+        Face_handle F = tds.create_face(vertices[index[0]],
+                                        vertices[index[1]],
+                                        vertices[index[2]]);
+        for (int i=0; i<3; i++)
+        {
+            vertices[index[i]]->set_face(F);
+
+            OpenEdge e;
+            e.f = F;
+            e.i = i;
+            e.a = index[Strip_dt::ccw(i)];
+            e.b = index[Strip_dt::cw(i)];
+            open.push_back(e);
+        }
+    }
+
+    // Match the open edges in pairs. An edge with no partner is on the
+    // convex hull, and gets an infinite face (b, a, infinite).
+    Edge_map edges;
+    edges.rehash(2 * open.size());
+    for (unsigned int k=0; k<open.size(); k++)
+        edges[edgeKey(open[k].a, open[k].b)] =
+            std::make_pair(open[k].f, open[k].i);
+
+    if (edges.size() != open.size())
+        return false;
+
+    boost::unordered_map<int, Face_handle> hullOut;
+    boost::unordered_map<int, Face_handle> hullIn;
+
+    for (unsigned int k=0; k<open.size(); k++)
+    {
+        const OpenEdge& e = open[k];
+
+        Edge_map::const_iterator twin = edges.find(edgeKey(e.b, e.a));
+        if (twin != edges.end())
+        {
+            e.f->set_neighbor(e.i, twin->second.first);
+            continue;
+        }
+
+        Face_handle h = tds.create_face(vertices[e.b], vertices[e.a],
+                                        infinite);
+        h->set_neighbor(2, e.f);
+        e.f->set_neighbor(e.i, h);
+        infinite->set_face(h);
+
+        // h has the directed edges a->infinite (opposite 0) and
+        // infinite->b (opposite 1).
+        if (hullOut.count(e.a) || hullIn.count(e.b))
+            return false;
+        hullOut[e.a] = h;
+        hullIn[e.b]  = h;
+    }
+
+    if (hullOut.empty() || hullOut.size() != hullIn.size())
+        return false;
+
+    boost::unordered_map<int, Face_handle>::const_iterator out;
+    for (out=hullOut.begin(); out!=hullOut.end(); ++out)
+    {
+        boost::unordered_map<int, Face_handle>::const_iterator in =
+            hullIn.find(out->first);
+        if (in == hullIn.end())
+            return false;
+
+        out->second->set_neighbor(0, in->second);
+        in->second->set_neighbor(1, out->second);
+    }
+
+    return true;
+}
+
+/*****************************************************************************/
+
+void parallelInsert(Delaunay*                 dt,
+                    const std::vector<Point>& points,
+                    int                       strips)
+{
+    if (strips <= 0)
+        strips = QThread::idealThreadCount();
+
+    int n = points.size();
+
+    if (dt->number_of_vertices() > 0 || strips < 2 ||
+        n < PARALLEL_MIN_POINTS * strips)
+    {
+        dt->insert(points.begin(), points.end());
+        return;
+    }
+
+    // Split at quantiles of a sample of the x coordinates.
+    std::vector<double> sample;
+    int step = qMax(1, n / (strips * 256));
+    for (int i=0; i<n; i+=step)
+        sample.push_back(points[i].x());
+    std::sort(sample.begin(), sample.end());
+
+    std::vector<double> splits(strips - 1);
+    for (int k=0; k<strips-1; k++)
+        splits[k] = sample[((k+1) * sample.size()) / strips];
+
+    const double infinity = std::numeric_limits<double>::infinity();
+
+    std::vector<Strip> parts(strips);
+    for (int k=0; k<strips; k++)
+    {
+        parts[k].lo = k == 0        ? -infinity : splits[k-1];
+        parts[k].hi = k == strips-1 ?  infinity : splits[k];
+        parts[k].dt = 0;
+        parts[k].points.reserve(n / strips + n / 16);
+    }
+
+    for (int i=0; i<n; i++)
+    {
+        int k = std::upper_bound(splits.begin(), splits.end(), points[i].x())
+                - splits.begin();
+        parts[k].points.push_back(Indexed_point(points[i], i));
+    }
+
+    StripBuilder builder;
+    builder.strips = &parts[0];
+    parallelChunks(strips, 1, builder);
+
+    bool ok = assemble(dt, points, parts, splits);
+
+    for (int k=0; k<strips; k++)
+        delete parts[k].dt;
+
+    // Only degenerate inputs get here, such as many cocircular points
+    // whose triangulation is not unique.
+    if (!ok)
+    {
+        dt->clear();
+        dt->insert(points.begin(), points.end());
+    }
+}
+
+/*****************************************************************************/
+
+// Compare parallelInsert() against serial insertion, limiting the thread
+// pool to 1, 2, 4, ... threads up to the number of cores.
+//
+//  --construction   Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --seed           Seed for the pointsets.
+//  --distributions  Point distributions to build.
+//  --validate       Also run is_valid() on each parallel result.
+int runConstructionBenchmark(const QStringList& args)
+{
+    QList<int>   sizes    = argIntList(args, "--n", "1000000");
+    QList<int>   dists    = argDistributions(args);
+    unsigned int seed     = argValue(args, "--seed", "1").toUInt();
+    bool         validate = args.contains("--validate");
+    int          cores    = QThread::idealThreadCount();
+
+    QList<int> threads;
+    for (int t=1; t<cores; t*=2)
+        threads << t;
+    threads << cores;
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-10s %10s %8s %10s %8s %8s\n")
+                 % "points" % "n" % "threads" % "ms" % "speedup" % "valid";
+
+    for (int d=0; d<dists.size(); d++)
+    {
+        for (int s=0; s<sizes.size(); s++)
+        {
+            std::vector<Point> points;
+            generatePoints(dists[d], sizes[s], seed, points);
+
+            QElapsedTimer timer;
+            timer.start();
+            Delaunay serial;
+            serial.insert(points.begin(), points.end());
+            double serialMs = timer.nsecsElapsed() / 1e6;
+
+            std::cout << boost::format("%-10s %10d %8s %10.1f %8.2f %8s\n")
+                         % distributionName(dists[d]) % sizes[s] % "serial"
+                         % serialMs % 1.0 % "-";
+
+            for (int t=0; t<threads.size(); t++)
+            {
+                QThreadPool::globalInstance()->setMaxThreadCount(threads[t]);
+
+                timer.start();
+                Delaunay dt;
+                parallelInsert(&dt, points, threads[t]);
+                double ms = timer.nsecsElapsed() / 1e6;
+
+                // The triangulation is unique for points in general
+                // position, so the face count must match the serial one.
+                bool same = dt.number_of_faces() == serial.number_of_faces();
+                const char* valid = !same     ? "no"
+                                  : !validate ? "-"
+                                  : dt.is_valid() ? "yes" : "no";
+
+                std::cout << boost::format("%-10s %10d %8d %10.1f %8.2f %8s\n")
+                             % distributionName(dists[d]) % sizes[s]
+                             % threads[t] % ms % (serialMs / ms) % valid;
+            }
+
+            QThreadPool::globalInstance()->setMaxThreadCount(cores);
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,40 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Parallel construction of a Delaunay triangulation.
+*
+* The points are split into vertical strips, each strip is triangulated on
+* its own thread, and the seams between strips are repaired by a small
+* triangulation of the points near them. The result is an ordinary Delaunay
+* that the walks can use unchanged.
+*
+******************************************************************************/
+
+#ifndef PARALLEL_DELAUNAY_H
+#define PARALLEL_DELAUNAY_H
+
+/*****************************************************************************/
+
+#include <vector>
+
+#include "mainwindow.h"
+
+/*****************************************************************************/
+
+// Below this many points per strip the serial insertion is used instead.
+const int PARALLEL_MIN_POINTS = 10000;
+
+/*****************************************************************************/
+
+// Insert points into the empty triangulation dt, using the given number of
+// strips (0 uses one per core). Falls back to a serial insert if dt is not
+// empty, the input is too small, or the seams cannot be repaired (which
+// can only happen for degenerate inputs).
+void parallelInsert(Delaunay*                 dt,
+                    const std::vector<Point>& points,
+                    int                       strips=0);
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,332 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Performance regression checks against stored baseline numbers.
+*
+* Every metric is "lower is better". Timings are the best of several runs
+* to reduce noise, counts are deterministic for a fixed seed and so should
+* only change when the walks themselves change.
+*
+******************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <boost/format.hpp>
+
+#include <QFile>
+#include <QTextStream>
+#include <QDateTime>
+#include <QMap>
+#include <QPair>
+
+#include "benchmark.h"
+
+/*****************************************************************************/
+
+// Number of repetitions for each timing, we keep the fastest.
+static const int    PERF_REPEATS            = 5;
+
+// Tolerances written by --perf-update. Timings are noisy, counts are exact
+// for the fixed seed on any machine.
+static const double PERF_TIME_TOLERANCE     = 0.25;
+static const double PERF_COUNT_TOLERANCE    = 0;
+
+/******************************************************************************
+* A single measured value.
+******************************************************************************/
+
+struct PerfMetric
+{
+    QString  name;
+    double   value;
+    double   tolerance;
+};
+
+typedef QMap< QString, QPair<double,double> >   PerfBaseline;
+
+/*****************************************************************************/
+
+// Timings depend on the machine, everything else is a count.
+static bool isTiming(const QString& name)
+{
+    return name.endsWith(".ns") || name.endsWith(".ms");
+}
+
+/*****************************************************************************/
+
+static void addMetric(QList<PerfMetric>& metrics,
+                      const QString&     name,
+                      double             value,
+                      double             tolerance)
+{
+    PerfMetric m;
+    m.name      = name;
+    m.value     = value;
+    m.tolerance = tolerance;
+    metrics.append(m);
+}
+
+/*****************************************************************************/
+
+// Time getGraphics() for walks of type W, returning ns per walk.
+template <typename W>
+static double measureRender(Delaunay*                       dt,
+                            const std::vector<Point>&       targets,
+                            const std::vector<Face_handle>& starts)
+{
+    qint64        total = 0;
+    QElapsedTimer timer;
+
+    for (unsigned int i=0; i<targets.size(); i++)
+    {
+        W w(targets[i], dt, starts[i], i);
+
+        timer.start();
+        QGraphicsItemGroup* g = w.getGraphics();
+        total += timer.nsecsElapsed();
+
+        delete g;
+    }
+
+    return targets.empty() ? 0 : total / (double)targets.size();
+}
+
+/*****************************************************************************/
+
+// Collect the locate, render and memory metrics of one strategy.
+template <typename W>
+static void measureStrategy(QList<PerfMetric>&              metrics,
+                            const QString&                  prefix,
+                            Delaunay*                       dt,
+                            const std::vector<Point>&       targets,
+                            const std::vector<Face_handle>& starts)
+{
+    WalkCost best   = measureWalks<W>(dt, targets, starts);
+    double   render = measureRender<W>(dt, targets, starts);
+
+    for (int r=1; r<PERF_REPEATS; r++)
+    {
+        best.ns = qMin(best.ns,  measureWalks<W> (dt, targets, starts).ns);
+        render  = qMin(render,   measureRender<W>(dt, targets, starts));
+    }
+
+    addMetric(metrics, "locate."       + prefix + ".ns",
+              best.ns,                  PERF_TIME_TOLERANCE);
+    addMetric(metrics, "orientations." + prefix,
+              best.orientations,        PERF_COUNT_TOLERANCE);
+    addMetric(metrics, "render."       + prefix + ".ns",
+              render,                   PERF_TIME_TOLERANCE);
+
+    // Memory held by the trace of visited faces for each query.
+    addMetric(metrics, "memory."       + prefix + ".bytes",
+              best.traceBytes,          PERF_COUNT_TOLERANCE);
+}
+
+/*****************************************************************************/
+
+// Baseline files hold one "name value tolerance" entry per line. Lines
+// starting with # are comments.
+static bool readBaseline(const QString& filename, PerfBaseline& baseline)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+
+        QStringList items = line.split(QRegExp("\\s+"));
+        if (items.size() < 3)
+            continue;
+
+        baseline[items[0]] = qMakePair(items[1].toDouble(),
+                                       items[2].toDouble());
+    }
+
+    return true;
+}
+
+/*****************************************************************************/
+
+static bool writeBaseline(const QString&           filename,
+                          const QList<PerfMetric>& metrics)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text))
+        return false;
+
+    // Enough digits for counts to read back exactly.
+    QTextStream out(&file);
+    out.setRealNumberPrecision(17);
+    out << "# Performance baseline written by --perf-update on "
+        << QDateTime::currentDateTime().toString(Qt::ISODate) << "\n"
+        << "# name value tolerance\n";
+
+    for (int i=0; i<metrics.size(); i++)
+        out << metrics[i].name      << " "
+            << metrics[i].value     << " "
+            << metrics[i].tolerance << "\n";
+
+    return true;
+}
+
+/*****************************************************************************/
+
+// Run the fixed performance suite and compare it against a baseline.
+//
+//  --perf-check     Baseline file to compare against.
+//  --perf-update    Write the measured values as the new baseline instead.
+//  --tolerance      Override the tolerance of every timing metric.
+//  --counts-only    Only fail on counts, report timings without checking.
+//  --json           Also write the results as JSON to this file.
+//  --n              Triangulation sizes (default 10000,100000).
+//  --queries        Walks per strategy and size (default 2000).
+//
+// Exits with 1 if any metric is worse than baseline * (1 + tolerance), or
+// is checked but has no entry in the baseline.
+int runPerfCheck(const QStringList& args)
+{
+    QString      baselineFile = argValue(args, "--perf-check");
+    QString      updateFile   = argValue(args, "--perf-update");
+    QString      jsonFile     = argValue(args, "--json");
+    QString      tolerance    = argValue(args, "--tolerance");
+    bool         countsOnly   = args.contains("--counts-only");
+    QList<int>   sizes        = argIntList(args, "--n", "10000,100000");
+    int          queries      = argValue(args, "--queries", "2000").toInt();
+
+    // The suite always runs on the same seed.
+    const unsigned int seed   = 1;
+
+    silenceDebugOutput();
+
+    QList<PerfMetric> metrics;
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        QString n = QString::number(sizes[s]);
+
+        std::vector<Point> points;
+        generatePoints(UNIFORM_SQUARE, sizes[s], seed, points);
+
+        // Construction time.
+        Delaunay      dt;
+        QElapsedTimer timer;
+        double        construct = 0;
+        for (int r=0; r<PERF_REPEATS; r++)
+        {
+            dt.clear();
+            timer.start();
+            dt.insert(points.begin(), points.end());
+            double ms = timer.nsecsElapsed() / 1e6;
+            construct = (r == 0) ? ms : qMin(construct, ms);
+        }
+        addMetric(metrics, "construct." + n + ".ms", construct,
+                  PERF_TIME_TOLERANCE);
+
+        std::vector<Point>       targets;
+        std::vector<Face_handle> starts;
+        makeQueries(&dt, UNIFORM_SQUARE, queries, seed, targets, starts);
+
+        measureStrategy< StraightWalk<Delaunay>   >
+            (metrics, QString(strategyName(STRAIGHT_WALK))   + "." + n,
+             &dt, targets, starts);
+        measureStrategy< VisibilityWalk<Delaunay> >
+            (metrics, QString(strategyName(VISIBILITY_WALK)) + "." + n,
+             &dt, targets, starts);
+        measureStrategy< PivotWalk<Delaunay>      >
+            (metrics, QString(strategyName(PIVOT_WALK))      + "." + n,
+             &dt, targets, starts);
+    }
+
+    if (!updateFile.isEmpty())
+    {
+        if (!writeBaseline(updateFile, metrics))
+        {
+            std::cerr << "Could not write " << updateFile.toStdString()
+                      << std::endl;
+            return 1;
+        }
+        std::cout << "Wrote baseline " << updateFile.toStdString()
+                  << std::endl;
+    }
+
+    PerfBaseline baseline;
+    if (!baselineFile.isEmpty() && !readBaseline(baselineFile, baseline))
+    {
+        std::cerr << "Could not read " << baselineFile.toStdString()
+                  << std::endl;
+        return 1;
+    }
+
+    std::ofstream json;
+    if (!jsonFile.isEmpty())
+    {
+        json.open(jsonFile.toStdString().c_str());
+        json << "{\n  \"timestamp\": \""
+             << QDateTime::currentDateTime().toString(Qt::ISODate)
+                                            .toStdString()
+             << "\",\n  \"metrics\": {";
+    }
+
+    std::cout << boost::format("%-32s %14s %14s %8s  %s\n")
+                 % "metric" % "value" % "baseline" % "change" % "status";
+
+    int failures = 0;
+    for (int i=0; i<metrics.size(); i++)
+    {
+        const PerfMetric& m = metrics[i];
+        const char* status  = "new";
+        double      base    = 0;
+        double      tol     = m.tolerance;
+        double      change  = 0;
+        bool        checked = !baselineFile.isEmpty()
+                           && !(countsOnly && isTiming(m.name));
+
+        if (baseline.contains(m.name))
+        {
+            base = baseline[m.name].first;
+            tol  = baseline[m.name].second;
+
+            if (!tolerance.isEmpty() && isTiming(m.name))
+                tol = tolerance.toDouble();
+
+            change = base > 0 ? m.value / base - 1 : 0;
+            status = checked ? "ok" : "unchecked";
+
+            if (checked && m.value > base * (1 + tol) + 1e-9)
+            {
+                status = "REGRESSION";
+                failures++;
+            }
+        }
+        else if (checked)
+        {
+            // A check that cannot fail is no check at all.
+            status = "MISSING";
+            failures++;
+        }
+
+        std::cout << boost::format("%-32s %14.2f %14.2f %+7.1f%%  %s\n")
+                     % m.name.toStdString() % m.value % base
+                     % (100*change) % status;
+
+        if (json.is_open())
+        {
+            json << (i ? "," : "") << "\n    \"" << m.name.toStdString()
+                 << "\": { \"value\": "   << m.value
+                 << ", \"baseline\": "    << base
+                 << ", \"tolerance\": "   << tol
+                 << ", \"status\": \""    << status << "\" }";
+        }
+    }
+
+    if (json.is_open())
+        json << "\n  },\n  \"regressions\": " << failures << "\n}\n";
+
+    return failures == 0 ? 0 : 1;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,103 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Rolling timing statistics for the interactive performance panel.
+******************************************************************************/
+
+#ifndef PERFSTATS_H
+#define PERFSTATS_H
+
+/*****************************************************************************/
+
+#include <algorithm>
+#include <vector>
+
+#include <QElapsedTimer>
+#include <QGraphicsView>
+#include <QPaintEvent>
+
+/*****************************************************************************/
+
+// Number of samples kept by each PerfWindow.
+const int PERF_WINDOW = 100;
+
+/******************************************************************************
+* The last PERF_WINDOW samples of a timing, in nanoseconds.
+******************************************************************************/
+
+class PerfWindow
+{
+public:
+    PerfWindow() : next(0), latest(0) {}
+
+    void add(qint64 ns)
+    {
+        if (samples.size() < (unsigned int)PERF_WINDOW)
+            samples.push_back(ns);
+        else
+            samples[next] = ns;
+
+        next   = (next + 1) % PERF_WINDOW;
+        latest = ns;
+    }
+
+    bool    isEmpty() const { return samples.empty(); }
+    qint64  last()    const { return latest;          }
+
+    double mean() const
+    {
+        if (samples.empty())
+            return 0;
+
+        double sum = 0;
+        for (unsigned int i=0; i<samples.size(); i++)
+            sum += samples[i];
+        return sum / samples.size();
+    }
+
+    // The q-th percentile (0 to 100) by the nearest rank.
+    qint64 percentile(double q) const
+    {
+        if (samples.empty())
+            return 0;
+
+        std::vector<qint64> sorted(samples);
+        unsigned int rank = (unsigned int)(q / 100 * (sorted.size() - 1) + 0.5);
+        std::nth_element(sorted.begin(), sorted.begin() + rank, sorted.end());
+        return sorted[rank];
+    }
+
+private:
+    std::vector<qint64>             samples;
+    int                             next;
+    qint64                          latest;
+};
+
+/******************************************************************************
+* A graphics view that records how long each repaint takes.
+******************************************************************************/
+
+class TimedGraphicsView : public QGraphicsView
+{
+public:
+    TimedGraphicsView(QGraphicsScene* scene) : QGraphicsView(scene) {}
+
+    const PerfWindow& paintTimes() const { return paints; }
+
+protected:
+    void paintEvent(QPaintEvent* event)
+    {
+        QElapsedTimer timer;
+        timer.start();
+        QGraphicsView::paintEvent(event);
+        paints.add(timer.nsecsElapsed());
+    }
+
+private:
+    PerfWindow                      paints;
+};
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,216 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Point distributions used to build test triangulations.
+*
+* Walk cost depends heavily on how the points are distributed, so as well as
+* the uniform square we provide clustered, heavy-tailed and degenerate sets.
+* All generators are filled in parallel, one seeded random stream per chunk,
+* so the same (distribution, n, seed) always gives the same points.
+*
+******************************************************************************/
+
+#ifndef POINT_GENERATORS_H
+#define POINT_GENERATORS_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <vector>
+
+#include <CGAL/Random.h>
+
+#include "parallel.h"
+
+/*****************************************************************************/
+
+enum PointDistribution
+{
+    UNIFORM_SQUARE = 0,
+    GAUSSIAN_CLUSTERS,
+    KUZMIN,
+    CIRCLE,
+    PARABOLA,
+    JITTERED_GRID,
+    ANISOTROPIC_STRIPS,
+    NUM_DISTRIBUTIONS
+};
+
+/*****************************************************************************/
+
+// Half the side of the region the points are generated in. This matches the
+// square previously used by randomTriangulation().
+const double GENERATOR_RADIUS    = 400.;
+
+// Number of points generated by each random stream.
+const int    GENERATOR_CHUNK     = 4096;
+
+const int    NUM_CLUSTERS        = 16;
+const int    NUM_STRIPS          = 8;
+
+/*****************************************************************************/
+
+// Human readable name for each distribution, as used in the dialog and in
+// benchmark output.
+inline const char* distributionName(int distribution)
+{
+    switch (distribution)
+    {
+        case UNIFORM_SQUARE:     return "uniform";
+        case GAUSSIAN_CLUSTERS:  return "clusters";
+        case KUZMIN:             return "kuzmin";
+        case CIRCLE:             return "circle";
+        case PARABOLA:           return "parabola";
+        case JITTERED_GRID:      return "grid";
+        case ANISOTROPIC_STRIPS: return "strips";
+        default:                 return "unknown";
+    }
+}
+
+/*****************************************************************************/
+
+// Standard normal variate using the Box-Muller transform.
+inline double gaussian(CGAL::Random& random)
+{
+    double u = 1. - random.get_double();
+    double v = random.get_double();
+    return std::sqrt(-2. * std::log(u)) * std::cos(2. * M_PI * v);
+}
+
+/******************************************************************************
+* Fills one chunk of the output array.
+******************************************************************************/
+
+template <typename Point>
+struct PointChunkGenerator
+{
+    int                 distribution;
+    int                 n;
+    unsigned int        seed;
+    Point*              out;
+
+    // Shared parameters, derived once from the seed.
+    const double*       cluster_x;
+    const double*       cluster_y;
+
+    void operator()(int chunk, int begin, int end)
+    {
+        // Every chunk gets its own stream so the output does not depend on
+        // the order in which the chunks are scheduled.
+        CGAL::Random random(seed * 2654435761u + chunk);
+
+        const double r = GENERATOR_RADIUS;
+
+        // The grid used by JITTERED_GRID.
+        int    side    = (int)std::ceil(std::sqrt((double)n));
+        double spacing = 2*r / side;
+
+        for (int i=begin; i<end; i++)
+        {
+            double x=0, y=0;
+
+            switch (distribution)
+            {
+                case GAUSSIAN_CLUSTERS:
+                {
+                    int c = random.get_int(0, NUM_CLUSTERS);
+                    x = cluster_x[c] + gaussian(random) * r/20;
+                    y = cluster_y[c] + gaussian(random) * r/20;
+                    break;
+                }
+
+                case KUZMIN:
+                {
+                    // Invert the Kuzmin disk cumulative mass
+                    // M(s) = 1 - 1/sqrt(1+s^2).
+                    double u = random.get_double();
+                    double s = std::sqrt(1./((1.-u)*(1.-u)) - 1.);
+                    double a = random.get_double(0, 2*M_PI);
+                    x = std::cos(a) * s * r/10;
+                    y = std::sin(a) * s * r/10;
+                    break;
+                }
+
+                case CIRCLE:
+                {
+                    double a = random.get_double(0, 2*M_PI);
+                    x = std::cos(a) * r;
+                    y = std::sin(a) * r;
+                    break;
+                }
+
+                case PARABOLA:
+                {
+                    x = random.get_double(-r, r);
+                    y = x*x/r - r/2;
+                    break;
+                }
+
+                case JITTERED_GRID:
+                {
+                    x = -r + (i % side + 0.5) * spacing
+                            + random.get_double(-0.1, 0.1) * spacing;
+                    y = -r + (i / side + 0.5) * spacing
+                            + random.get_double(-0.1, 0.1) * spacing;
+                    break;
+                }
+
+                case ANISOTROPIC_STRIPS:
+                {
+                    int s = random.get_int(0, NUM_STRIPS);
+                    x = random.get_double(-r, r);
+                    y = -r + (s + 0.5) * 2*r/NUM_STRIPS
+                           + random.get_double(-r/200, r/200);
+                    break;
+                }
+
+                case UNIFORM_SQUARE:
+                default:
+                    x = random.get_double(-r, r);
+                    y = random.get_double(-r, r);
+                    break;
+            }
+
+            out[i] = Point(x, y);
+        }
+    }
+};
+
+/*****************************************************************************/
+
+// Generate n points from the given distribution into out.
+template <typename Point>
+void generatePoints(int                 distribution,
+                    int                 n,
+                    unsigned int        seed,
+                    std::vector<Point>& out)
+{
+    out.resize(n);
+    if (n == 0)
+        return;
+
+    // Cluster centres are shared by every chunk.
+    double cluster_x[NUM_CLUSTERS];
+    double cluster_y[NUM_CLUSTERS];
+    CGAL::Random random(seed);
+    for (int i=0; i<NUM_CLUSTERS; i++)
+    {
+        cluster_x[i] = random.get_double(-0.75, 0.75) * GENERATOR_RADIUS;
+        cluster_y[i] = random.get_double(-0.75, 0.75) * GENERATOR_RADIUS;
+    }
+
+    PointChunkGenerator<Point> g;
+    g.distribution = distribution;
+    g.n            = n;
+    g.seed         = seed;
+    g.out          = &out[0];
+    g.cluster_x    = cluster_x;
+    g.cluster_y    = cluster_y;
+
+    parallelChunks(n, GENERATOR_CHUNK, g);
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
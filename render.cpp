@@ -0,0 +1,328 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Headless rendering of walks to image files.
+*
+* All of the work on the triangulation (the walks themselves) is done up
+* front on the main thread. Each figure is then just a list of polygons and
+* points drawn over a shared, precomputed set of triangulation edges, so the
+* figures can be painted onto QImages or SVG files on the thread pool.
+*
+******************************************************************************/
+
+#include <iostream>
+
+#include <QDir>
+#include <QFile>
+#include <QTextStream>
+#include <QImage>
+#include <QPainter>
+#include <QSvgGenerator>
+
+#include "benchmark.h"
+#include "parallel.h"
+
+/*****************************************************************************/
+
+// Fill colours of the walks, as in the interactive window.
+static const char* walkColour(int strategy)
+{
+    switch (strategy)
+    {
+        case STRAIGHT_WALK:     return "#EBEBD2";
+        case VISIBILITY_WALK:   return "#D2D2EB";
+        case PIVOT_WALK:
+        default:                return "#EBD2D2";
+    }
+}
+
+/******************************************************************************
+* Everything needed to paint one output file.
+******************************************************************************/
+
+struct Figure
+{
+    QString             file;
+    QList<QPolygonF>    triangles;
+    QList<QPointF>      pivots;
+    QPointF             source;
+    QPointF             target;
+    int                 strategy;
+};
+
+/*****************************************************************************/
+
+// Geometry shared by every figure.
+struct Scene
+{
+    QVector<QLineF>     edges;
+    QVector<QPointF>    vertices;
+    QRectF              bounds;
+    int                 size;
+    bool                svg;
+};
+
+/*****************************************************************************/
+
+static void paintFigure(QPainter& painter, const Scene& scene, const Figure& f)
+{
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.fillRect(QRectF(0, 0, scene.size, scene.size), Qt::white);
+
+    // Fit the bounds of the triangulation to the image, with y up.
+    double margin = 0.05 * scene.size;
+    double scale  = (scene.size - 2*margin) /
+                    qMax(scene.bounds.width(), scene.bounds.height());
+
+    QTransform t;
+    t.translate(margin, scene.size - margin);
+    t.scale(scale, -scale);
+    t.translate(-scene.bounds.left(), -scene.bounds.top());
+    painter.setTransform(t);
+
+    // Pens of width zero are one pixel wide whatever the transform.
+    QPen thin(Qt::black, 0);
+
+    painter.setPen(thin);
+    painter.setBrush(QColor(walkColour(f.strategy)));
+    for (int i=0; i<f.triangles.size(); i++)
+        painter.drawPolygon(f.triangles[i]);
+
+    painter.setPen(QPen(Qt::gray, 0));
+    painter.drawLines(scene.edges);
+
+    // Markers are sized in pixels, so draw them without the transform.
+    painter.resetTransform();
+
+    painter.setPen(QPen(Qt::red, 3, Qt::SolidLine, Qt::RoundCap));
+    painter.drawPoints(t.map(QPolygonF(scene.vertices)));
+
+    painter.setPen(QPen(Qt::blue));
+    painter.setBrush(Qt::blue);
+    for (int i=0; i<f.pivots.size(); i++)
+        painter.drawEllipse(t.map(f.pivots[i]), 4, 4);
+
+    painter.setPen(QPen(Qt::black));
+    painter.setBrush(Qt::black);
+    painter.drawEllipse(t.map(f.source), 4, 4);
+    painter.setBrush(Qt::white);
+    painter.drawEllipse(t.map(f.target), 4, 4);
+}
+
+/*****************************************************************************/
+
+struct FigureWriter
+{
+    const Scene*        scene;
+    const Figure*       figures;
+
+    void operator()(int, int begin, int end)
+    {
+        for (int i=begin; i<end; i++)
+            write(figures[i]);
+    }
+
+    void write(const Figure& f)
+    {
+        if (scene->svg)
+        {
+            QSvgGenerator svg;
+            svg.setFileName(f.file);
+            svg.setSize(QSize(scene->size, scene->size));
+            svg.setViewBox(QRect(0, 0, scene->size, scene->size));
+
+            QPainter painter(&svg);
+            paintFigure(painter, *scene, f);
+            return;
+        }
+
+        QImage image(scene->size, scene->size, QImage::Format_ARGB32);
+        QPainter painter(&image);
+        paintFigure(painter, *scene, f);
+        painter.end();
+        image.save(f.file);
+    }
+};
+
+/*****************************************************************************/
+
+// Read walks from a script, one "x1 y1 x2 y2" per line, walking from the
+// face containing (x1,y1) to (x2,y2). Lines starting with # are skipped.
+static bool readScript(const QString&       path,
+                       QList<Point>&        sources,
+                       QList<Point>&        targets)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        return false;
+
+    QTextStream in(&file);
+    while (!in.atEnd())
+    {
+        QString line = in.readLine().trimmed();
+        if (line.isEmpty() || line.startsWith("#"))
+            continue;
+
+        QStringList v = line.split(QRegExp("\\s+"));
+        if (v.size() != 4)
+            return false;
+
+        sources << Point(v[0].toDouble(), v[1].toDouble());
+        targets << Point(v[2].toDouble(), v[3].toDouble());
+    }
+    return true;
+}
+
+/*****************************************************************************/
+
+// Render every strategy for every walk into its own file.
+//
+//  --render         Output directory.
+//  --n              Number of points in the triangulation.
+//  --distributions  Point distribution (the first one is used).
+//  --seed           Seed for the pointset, the walks and the queries.
+//  --walks          Number of random walks, when no script is given.
+//  --script         File of walks to render instead of random ones.
+//  --size           Width and height of the images in pixels.
+//  --svg            Write SVG files instead of PNG.
+int runRender(const QStringList& args)
+{
+    QString      dir     = argValue(args, "--render");
+    int          n       = argValue(args, "--n",     "500" ).toInt();
+    int          walks   = argValue(args, "--walks", "10"  ).toInt();
+    unsigned int seed    = argValue(args, "--seed",  "1"   ).toUInt();
+    QString      script  = argValue(args, "--script");
+    QList<int>   dists   = argDistributions(args);
+    int          dist    = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+
+    Scene scene;
+    scene.size = argValue(args, "--size", "800").toInt();
+    scene.svg  = args.contains("--svg");
+
+    if (dir.isEmpty() || !QDir().mkpath(dir))
+    {
+        std::cerr << "Cannot create output directory" << std::endl;
+        return 1;
+    }
+
+    silenceDebugOutput();
+
+    Delaunay dt;
+    buildTriangulation(&dt, dist, n, seed);
+
+    if (dt.dimension() < 2)
+    {
+        std::cerr << "Degenerate triangulation" << std::endl;
+        return 1;
+    }
+
+    // Cache the triangulation once for all of the figures.
+    Delaunay::Finite_edges_iterator e;
+    for (e = dt.finite_edges_begin(); e != dt.finite_edges_end(); ++e)
+    {
+        const Point& p = e->first->vertex(Delaunay::ccw(e->second))->point();
+        const Point& q = e->first->vertex(Delaunay::cw(e->second))->point();
+        scene.edges << QLineF(p.x(), p.y(), q.x(), q.y());
+    }
+
+    Delaunay::Finite_vertices_iterator v;
+    for (v = dt.finite_vertices_begin(); v != dt.finite_vertices_end(); ++v)
+        scene.vertices << QPointF(v->point().x(), v->point().y());
+
+    scene.bounds = QPolygonF(scene.vertices).boundingRect();
+
+    // The walks to draw.
+    QList<Point> sources;
+    QList<Point> targets;
+
+    if (!script.isEmpty())
+    {
+        if (!readScript(script, sources, targets))
+        {
+            std::cerr << "Cannot read script " << qPrintable(script)
+                      << std::endl;
+            return 1;
+        }
+    }
+    else
+    {
+        std::vector<Point>       t;
+        std::vector<Face_handle> s;
+        makeQueries(&dt, dist, walks, seed, t, s);
+
+        // Recover a source point inside each start face.
+        for (unsigned int i=0; i<t.size(); i++)
+        {
+            sources << CGAL::centroid(s[i]->vertex(0)->point(),
+                                      s[i]->vertex(1)->point(),
+                                      s[i]->vertex(2)->point());
+            targets << t[i];
+        }
+    }
+
+    // Do all of the walks here, the threads below only paint.
+    QList<Figure> figures;
+    for (int i=0; i<sources.size(); i++)
+    {
+        Face_handle f = dt.locate(sources[i]);
+        if (dt.is_infinite(f))
+            continue;
+
+        for (int strategy=0; strategy<NUM_STRATEGIES; strategy++)
+        {
+            Figure figure;
+            figure.strategy = strategy;
+            figure.source   = QPointF(sources[i].x(), sources[i].y());
+            figure.target   = QPointF(targets[i].x(), targets[i].y());
+            figure.file     = QDir(dir).filePath(
+                                  QString("walk_%1_%2.%3")
+                                      .arg(i, 4, 10, QChar('0'))
+                                      .arg(strategyName(strategy))
+                                      .arg(scene.svg ? "svg" : "png"));
+
+            QList<Face_handle> faces;
+            if (strategy == PIVOT_WALK)
+            {
+                PivotWalk<Delaunay> w(targets[i], &dt, f, seed + i);
+                faces = w.getFaces();
+                for (int k=0; k<w.getPivots().size(); k++)
+                    figure.pivots << QPointF(w.getPivots()[k].x(),
+                                             w.getPivots()[k].y());
+            }
+            else
+            {
+                runWalk(strategy, targets[i], &dt, f, seed + i, faces);
+            }
+
+            for (int k=0; k<faces.size(); k++)
+            {
+                if (dt.is_infinite(faces[k]))
+                    continue;
+
+                QPolygonF triangle;
+                for (int j=0; j<3; j++)
+                    triangle << QPointF(faces[k]->vertex(j)->point().x(),
+                                        faces[k]->vertex(j)->point().y());
+                figure.triangles << triangle;
+            }
+
+            figures << figure;
+        }
+    }
+
+    if (figures.isEmpty())
+        return 0;
+
+    // QList is not contiguous, so give the threads a vector.
+    QVector<Figure> work = figures.toVector();
+
+    FigureWriter writer;
+    writer.scene   = &scene;
+    writer.figures = work.constData();
+    parallelChunks(work.size(), 1, writer);
+
+    std::cout << work.size() << " figures written to "
+              << qPrintable(dir) << std::endl;
+    return 0;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,293 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Comparison of the different ways of choosing where a walk starts.
+******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <boost/format.hpp>
+
+#include <CGAL/Triangulation_hierarchy_vertex_base_2.h>
+#include <CGAL/Triangulation_hierarchy_2.h>
+
+#include "benchmark.h"
+#include "grid_index.h"
+#include "jump_and_walk.h"
+#include "kdtree_seeding.h"
+#include "hull_index.h"
+
+/*****************************************************************************/
+
+typedef CGAL::Triangulation_vertex_base_2<K>                Hierarchy_vbb;
+typedef CGAL::Triangulation_hierarchy_vertex_base_2<Hierarchy_vbb>
+                                                            Hierarchy_vb;
+typedef CGAL::Triangulation_face_base_2<K>                  Hierarchy_fb;
+typedef CGAL::Triangulation_data_structure_2<Hierarchy_vb,Hierarchy_fb>
+                                                            Hierarchy_tds;
+typedef CGAL::Delaunay_triangulation_2<K,Hierarchy_tds>     Hierarchy_dt;
+typedef CGAL::Triangulation_hierarchy_2<Hierarchy_dt>       Hierarchy;
+
+/*****************************************************************************/
+
+// Always start from the infinite face, as the walks do when not given a face.
+template <typename T>
+class InfiniteFaceOracle : public StartFaceOracle<T>
+{
+public:
+    InfiniteFaceOracle(T* dt) : dt(dt) {}
+
+    typename T::Face_handle startFace(const typename T::Point&)
+    {
+        return dt->infinite_face();
+    }
+
+private:
+    T* dt;
+};
+
+/*****************************************************************************/
+
+static void printSeedingRow(const QString&  method,
+                            int             n,
+                            double          buildMs,
+                            const WalkCost& cost)
+{
+    std::cout << boost::format("%-14s %10d %10.2f %10.1f %10.1f %10.1f "
+                               "%10.2f\n")
+                 % method.toStdString()
+                 % n
+                 % buildMs
+                 % cost.seedNs
+                 % cost.ns
+                 % (cost.seedNs + cost.ns)
+                 % cost.orientations;
+}
+
+/*****************************************************************************/
+
+// Seed walks of type W from a kd-tree, one query at a time and then as a
+// single parallel batch.
+template <typename W>
+static void kdTreeRows(Delaunay*                 dt,
+                       const std::vector<Point>& targets,
+                       int                       n,
+                       double                    epsilon)
+{
+    QElapsedTimer timer;
+    timer.start();
+    KdTreeSeeding<Delaunay> kd(dt, epsilon);
+    double buildMs = timer.nsecsElapsed() / 1e6;
+
+    printSeedingRow("kd-tree", n, buildMs,
+                    measureSeededWalks<W>(dt, kd, targets));
+
+    // The batch is timed by the wall clock, so its seeding time is the
+    // throughput over all threads.
+    std::vector<Face_handle> starts;
+    timer.start();
+    kd.startFaces(targets, starts);
+    qint64 ns = timer.nsecsElapsed();
+
+    WalkCost cost = measureWalks<W>(dt, targets, starts);
+    cost.seedNs   = targets.empty() ? 0 : ns / (double)targets.size();
+    printSeedingRow("kd-tree batch", n, buildMs, cost);
+}
+
+/*****************************************************************************/
+
+// Every seeding method for walks of type W.
+template <typename W>
+static void seedingRows(Delaunay*                 dt,
+                        const std::vector<Point>& targets,
+                        int                       n,
+                        const QList<int>&         cellPoints,
+                        double                    epsilon,
+                        unsigned int              seed)
+{
+    QElapsedTimer timer;
+
+    // From the infinite face.
+    InfiniteFaceOracle<Delaunay> infinite(dt);
+    printSeedingRow("infinite", n, 0,
+                    measureSeededWalks<W>(dt, infinite, targets));
+
+    // From the hull edge facing the target.
+    timer.start();
+    HullIndex<Delaunay> hull(dt);
+    double hullMs = timer.nsecsElapsed() / 1e6;
+    printSeedingRow("hull", n, hullMs,
+                    measureSeededWalks<W>(dt, hull, targets));
+
+    // Jump and walk.
+    timer.start();
+    JumpAndWalk<Delaunay> jump(dt, 0, seed);
+    double jumpMs = timer.nsecsElapsed() / 1e6;
+    printSeedingRow("jump-and-walk", n, jumpMs,
+                    measureSeededWalks<W>(dt, jump, targets));
+
+    // Grids of different resolutions.
+    for (int g=0; g<cellPoints.size(); g++)
+    {
+        int side = (int)std::ceil(std::sqrt(n / (double)cellPoints[g]));
+
+        timer.start();
+        GridIndex<Delaunay> grid(dt, side);
+        double gridMs = timer.nsecsElapsed() / 1e6;
+
+        printSeedingRow(QString("grid %1x%1").arg(side), n, gridMs,
+                        measureSeededWalks<W>(dt, grid, targets));
+    }
+
+    kdTreeRows<W>(dt, targets, n, epsilon);
+}
+
+/*****************************************************************************/
+
+// Locate points outside the convex hull, on a circle of twice the radius of
+// the distribution, with CGAL and with the hull index. Both must give an
+// infinite face whose edge is visible from the point.
+static void outsideRows(Delaunay* dt, int n, int queries, unsigned int seed)
+{
+    CGAL::Random       random(seed);
+    std::vector<Point> outside;
+    for (int i=0; i<queries; i++)
+    {
+        double angle = random.get_double(0, 2*M_PI);
+        outside.push_back(Point(2 * GENERATOR_RADIUS * std::cos(angle),
+                                2 * GENERATOR_RADIUS * std::sin(angle)));
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    HullIndex<Delaunay> hull(dt);
+    double hullMs = timer.nsecsElapsed() / 1e6;
+
+    std::vector<Face_handle> cgal(outside.size()), indexed(outside.size());
+
+    timer.start();
+    for (unsigned int i=0; i<outside.size(); i++)
+        cgal[i] = dt->locate(outside[i]);
+    double cgalNs = timer.nsecsElapsed();
+
+    timer.start();
+    for (unsigned int i=0; i<outside.size(); i++)
+        indexed[i] = hull.visibleFace(outside[i]);
+    double hullNs = timer.nsecsElapsed();
+
+    // A face is a valid answer if it is infinite and p is beyond its edge.
+    int valid[2] = { 0, 0 };
+    for (unsigned int i=0; i<outside.size(); i++)
+    {
+        Face_handle f[2] = { cgal[i], indexed[i] };
+        for (int k=0; k<2; k++)
+        {
+            if (f[k] == Face_handle() || !dt->is_infinite(f[k]))
+                continue;
+
+            int j = f[k]->index(dt->infinite_vertex());
+            if (dt->orientation(f[k]->vertex(f[k]->cw(j))->point(),
+                                f[k]->vertex(f[k]->ccw(j))->point(),
+                                outside[i]) != CGAL::LEFT_TURN)
+                valid[k]++;
+        }
+    }
+
+    double q = qMax(1, queries);
+    std::cout << boost::format("%-14s %10d %10.2f %10.1f %10s %10d\n")
+                 % "cgal locate" % n % 0.0 % (cgalNs / q) % "-" % valid[0];
+    std::cout << boost::format("%-14s %10d %10.2f %10.1f %10d %10d\n")
+                 % "hull index" % n % hullMs % (hullNs / q) % hull.size()
+                 % valid[1];
+}
+
+/*****************************************************************************/
+
+// Compare walks seeded from the infinite face, by jump-and-walk, by grids
+// of several resolutions and by a kd-tree, against the Delaunay hierarchy.
+// Seeding and walking are timed separately, so the n at which a seeding
+// method starts to pay for itself can be read off the table.
+//
+//  --seeding        Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --cell-points    Comma separated list of average points per grid cell,
+//                   one grid is built for each.
+//  --walk           Walk to seed, visibility (default) or pivot.
+//  --epsilon        Approximation factor of the kd-tree queries.
+//  --queries        Number of queries per method.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+//
+// A second table times locating points outside the convex hull, from the
+// infinite face with CGAL and by the hull index.
+int runSeedingBenchmark(const QStringList& args)
+{
+    QList<int>   sizes      = argIntList(args, "--n", "10000,100000,1000000");
+    QList<int>   cellPoints = argIntList(args, "--cell-points", "1,2,8,32");
+    QList<int>   dists      = argDistributions(args);
+    int          queries    = argValue(args, "--queries", "10000").toInt();
+    unsigned int seed       = argValue(args, "--seed",    "1"    ).toUInt();
+    int          dist       = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+    QString      walk       = argValue(args, "--walk",    "visibility");
+    double       epsilon    = argValue(args, "--epsilon", "0.5").toDouble();
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-14s %10s %10s %10s %10s %10s %10s\n")
+                 % "method" % "n" % "build ms" % "seed ns"
+                 % "walk ns" % "total ns" % "orient";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        int n = sizes[s];
+
+        std::vector<Point> points;
+        generatePoints(dist, n, seed, points);
+
+        Delaunay dt;
+        dt.insert(points.begin(), points.end());
+
+        std::vector<Point>       targets;
+        std::vector<Face_handle> unused;
+        makeQueries(&dt, dist, queries, seed, targets, unused);
+
+        if (walk == "pivot")
+            seedingRows< PivotWalk<Delaunay> >
+                (&dt, targets, n, cellPoints, epsilon, seed);
+        else
+            seedingRows< VisibilityWalk<Delaunay> >
+                (&dt, targets, n, cellPoints, epsilon, seed);
+
+        // The Delaunay hierarchy locates without a seed. Its build time is
+        // for the whole hierarchy, triangulation included.
+        QElapsedTimer timer;
+        timer.start();
+        Hierarchy hierarchy;
+        hierarchy.insert(points.begin(), points.end());
+        double hierarchyMs = timer.nsecsElapsed() / 1e6;
+
+        timer.start();
+        for (unsigned int i=0; i<targets.size(); i++)
+            hierarchy.locate(targets[i]);
+
+        WalkCost cost = {0, 0, 0, 0, 0, 0};
+        if (!targets.empty())
+            cost.ns = timer.nsecsElapsed() / (double)targets.size();
+        printSeedingRow("hierarchy", n, hierarchyMs, cost);
+    }
+
+    std::cout << "\n"
+              << boost::format("%-14s %10s %10s %10s %10s %10s\n")
+                 % "outside" % "n" % "build ms" % "locate ns" % "hull"
+                 % "valid";
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        Delaunay dt;
+        buildTriangulation(&dt, dist, sizes[s], seed);
+        outsideRows(&dt, sizes[s], queries, seed);
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
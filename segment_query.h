@@ -0,0 +1,394 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Batched queries for the faces crossed by segments and polylines.
+*
+* This is the straight walk, but stopping at the face that contains the end
+* of the segment, and recording for each face the edges the segment entered
+* and left it by. Each step needs one orientation to choose between the two
+* edges other than the one we came in by, and one more to see whether the
+* end of the segment lies beyond it.
+*
+* Results go into flat arrays rather than one list per segment. A segment
+* starts from the face the previous one ended in, so queries with some
+* spatial coherence, and polylines in particular, reach their start by a
+* short walk. That walk only reads the triangulation, unlike locate(),
+* which is not reentrant, so batches can run on the thread pool once the
+* first start of each has been located.
+*
+******************************************************************************/
+
+#ifndef SEGMENT_QUERY_H
+#define SEGMENT_QUERY_H
+
+/*****************************************************************************/
+
+#include <vector>
+
+#include "parallel.h"
+
+/*****************************************************************************/
+
+// Edge index recorded when a segment starts or ends inside a face.
+const unsigned char SEGMENT_NO_EDGE       = 3;
+
+// Segments per batch when running batches in parallel.
+const int           SEGMENT_BATCH_SIZE    = 1024;
+
+// A traversal gives up after this many faces per vertex of the
+// triangulation, plus SEGMENT_BUDGET_MIN. It only happens if the segment
+// runs exactly along edges.
+const int           SEGMENT_BUDGET_PER_VERTEX = 4;
+const int           SEGMENT_BUDGET_MIN        = 64;
+
+/******************************************************************************
+* Faces crossed by a batch of segments, in order. Segment s crossed
+*
+*     faces[offsets[s]] ... faces[offsets[s+1]-1]
+*
+* and edges[k] holds the index in faces[k] of the edge the segment entered
+* by in its low two bits, and of the edge it left by in the next two.
+******************************************************************************/
+
+template <typename T>
+struct SegmentBatch
+{
+    typedef typename T::Face_handle                     Face_handle;
+
+    std::vector<Face_handle>        faces;
+    std::vector<unsigned char>      edges;
+    std::vector<int>                offsets;
+
+    int                             orientations;   // Orientations performed.
+    int                             unfinished;     // Segments out of budget.
+
+    SegmentBatch() { clear(); }
+
+    void clear()
+    {
+        faces.clear();
+        edges.clear();
+        offsets.assign(1, 0);
+        orientations = 0;
+        unfinished   = 0;
+    }
+
+    int  numSegments()      const { return offsets.size() - 1;          }
+    int  entryEdge(int k)   const { return edges[k] & 3;                }
+    int  exitEdge(int k)    const { return edges[k] >> 2;               }
+
+    // Heap memory used by the results.
+    size_t bytes() const
+    {
+        return faces.capacity()   * sizeof(Face_handle)
+             + edges.capacity()
+             + offsets.capacity() * sizeof(int);
+    }
+};
+
+/*****************************************************************************/
+
+template <typename T>
+class SegmentQuery
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+
+public:
+    SegmentQuery(T* dt) : dt(dt)
+    {
+        budget = SEGMENT_BUDGET_MIN
+               + SEGMENT_BUDGET_PER_VERTEX * dt->number_of_vertices();
+    }
+
+    /*************************************************************************/
+
+    // Append the faces crossed by the segment from a to b to out, walking
+    // to a from start. Returns the face containing b, or the infinite face
+    // the segment left the convex hull through. A null start is found with
+    // locate(), so may only be given from one thread at a time.
+    Face_handle traverse(const Point&     a,
+                         const Point&     b,
+                         Face_handle      start,
+                         SegmentBatch<T>& out)
+    {
+        Face_handle f     = start == Face_handle() ? dt->locate(a)
+                                                   : walkTo(a, start, out);
+        int         entry = SEGMENT_NO_EDGE;
+
+        for (int steps=0; ; steps++)
+        {
+            if (dt->is_infinite(f))
+                break;
+
+            if (steps >= budget)
+            {
+                out.unfinished++;
+                break;
+            }
+
+            int exit = exitEdge(f, entry, a, b, out);
+
+            // The end of the segment is on this side of the exit edge.
+            if (exit == SEGMENT_NO_EDGE ||
+                orientation(f->vertex(f->ccw(exit))->point(),
+                            f->vertex(f->cw(exit))->point(),
+                            b, out) != CGAL::RIGHT_TURN)
+                break;
+
+            out.faces.push_back(f);
+            out.edges.push_back(entry | exit << 2);
+
+            Face_handle g = f->neighbor(exit);
+            entry         = g->index(f);
+            f             = g;
+        }
+
+        out.faces.push_back(f);
+        out.edges.push_back(entry | SEGMENT_NO_EDGE << 2);
+        out.offsets.push_back(out.faces.size());
+
+        return f;
+    }
+
+    /*************************************************************************/
+
+    // Segments given as pairs of endpoints, each starting from where the
+    // last one ended.
+    Face_handle segments(const Point*     endpoints,
+                         int              count,
+                         Face_handle      start,
+                         SegmentBatch<T>& out)
+    {
+        for (int s=0; s<count; s++)
+            start = traverse(endpoints[2*s], endpoints[2*s+1], start, out);
+        return start;
+    }
+
+    // The segments between consecutive vertices of a polyline.
+    Face_handle polyline(const Point*     vertices,
+                         int              count,
+                         Face_handle      start,
+                         SegmentBatch<T>& out)
+    {
+        for (int s=0; s+1<count; s++)
+            start = traverse(vertices[s], vertices[s+1], start, out);
+        return start;
+    }
+
+private:
+    /*************************************************************************/
+
+    // Visibility walk from f to the face containing a, or to an infinite
+    // face whose hull edge has a outside it. The order of the edges is
+    // fixed, which cannot cycle on a Delaunay triangulation.
+    Face_handle walkTo(const Point& a, Face_handle f, SegmentBatch<T>& out)
+    {
+        if (dt->dimension() < 2)
+            return f;
+
+        for (int steps=0; steps<budget; steps++)
+        {
+            if (dt->is_infinite(f))
+            {
+                // Outside the hull to the left of the finite edge (u, v).
+                int i = f->index(dt->infinite_vertex());
+                if (orientation(f->vertex(f->ccw(i))->point(),
+                                f->vertex(f->cw(i))->point(),
+                                a, out) == CGAL::LEFT_TURN)
+                    return f;
+
+                f = f->neighbor(i);
+                continue;
+            }
+
+            int k = 0;
+            while (k < 3 && orientation(f->vertex(f->ccw(k))->point(),
+                                        f->vertex(f->cw(k))->point(),
+                                        a, out) != CGAL::RIGHT_TURN)
+                k++;
+
+            if (k == 3)
+                return f;
+
+            f = f->neighbor(k);
+        }
+
+        return f;
+    }
+
+    /*************************************************************************/
+
+    // The edge of f that the line through a and b leaves it by, having
+    // come in by the given edge.
+    int exitEdge(Face_handle      f,
+                 int              entry,
+                 const Point&     a,
+                 const Point&     b,
+                 SegmentBatch<T>& out)
+    {
+        // We came in with the first vertex of the entry edge on the left
+        // of the line and the second not, so the opposite vertex decides.
+        if (entry != SEGMENT_NO_EDGE)
+        {
+            const Point& v = f->vertex(entry)->point();
+            return orientation(a, b, v, out) == CGAL::LEFT_TURN
+                   ? f->ccw(entry) : f->cw(entry);
+        }
+
+        // a is in f, so the line leaves by the edge whose first vertex is
+        // not on its left and whose second is.
+        bool left[3];
+        for (int i=0; i<3; i++)
+            left[i] = orientation(a, b, f->vertex(i)->point(), out)
+                                                        == CGAL::LEFT_TURN;
+
+        for (int i=0; i<3; i++)
+            if (!left[f->ccw(i)] && left[f->cw(i)])
+                return i;
+
+        // The line runs along an edge. Leave by any edge that has b on the
+        // far side.
+        for (int i=0; i<3; i++)
+            if (orientation(f->vertex(f->ccw(i))->point(),
+                            f->vertex(f->cw(i))->point(),
+                            b, out) == CGAL::RIGHT_TURN)
+                return i;
+
+        return SEGMENT_NO_EDGE;
+    }
+
+    /*************************************************************************/
+
+    CGAL::Orientation orientation(const Point&     p,
+                                  const Point&     q,
+                                  const Point&     r,
+                                  SegmentBatch<T>& out)
+    {
+        out.orientations++;
+        return dt->orientation(p, q, r);
+    }
+
+    T*                              dt;
+    int                             budget;
+};
+
+/******************************************************************************
+* Run batches of segments or polylines on the thread pool. Batch b holds
+* the results for the b'th run of SEGMENT_BATCH_SIZE segments (or of whole
+* polylines with about that many segments). The first segment of each batch
+* is located before the batches start, on the calling thread, and the rest
+* walk from where the one before ended.
+******************************************************************************/
+
+template <typename T>
+struct SegmentBatchRunner
+{
+    typedef typename T::Point                           Point;
+
+    typedef typename T::Face_handle                     Face_handle;
+
+    T*                              dt;
+    const Point*                    points;
+    const int*                      polylines;  // Null for plain segments.
+    const Face_handle*              starts;     // Located, one per batch.
+    SegmentBatch<T>*                batches;
+
+    void operator()(int chunk, int begin, int end)
+    {
+        SegmentQuery<T>  query(dt);
+        SegmentBatch<T>& out = batches[chunk];
+
+        out.clear();
+
+        if (!polylines)
+        {
+            query.segments(points + 2*begin, end - begin, starts[chunk],
+                           out);
+            return;
+        }
+
+        Face_handle start = starts[chunk];
+        for (int p=begin; p<end; p++)
+            start = query.polyline(points + polylines[p],
+                                   polylines[p+1] - polylines[p],
+                                   start, out);
+    }
+};
+
+/*****************************************************************************/
+
+// Segments given as consecutive pairs of endpoints.
+template <typename T>
+void parallelSegments(T*                                    dt,
+                      const std::vector<typename T::Point>& endpoints,
+                      std::vector< SegmentBatch<T> >&       batches,
+                      int                                   batchSize
+                                                        = SEGMENT_BATCH_SIZE)
+{
+    int n = endpoints.size() / 2;
+
+    batches.resize((n + batchSize - 1) / batchSize);
+    if (n == 0)
+        return;
+
+    std::vector<typename T::Face_handle> starts(batches.size());
+    for (unsigned int b=0; b<starts.size(); b++)
+        starts[b] = dt->locate(endpoints[2 * b * batchSize]);
+
+    SegmentBatchRunner<T> runner;
+    runner.dt        = dt;
+    runner.points    = &endpoints[0];
+    runner.polylines = 0;
+    runner.starts    = &starts[0];
+    runner.batches   = &batches[0];
+    parallelChunks(n, batchSize, runner);
+}
+
+/*****************************************************************************/
+
+// Polyline p has the vertices from vertices[offsets[p]] up to but not
+// including vertices[offsets[p+1]].
+template <typename T>
+void parallelPolylines(T*                                    dt,
+                       const std::vector<typename T::Point>& vertices,
+                       const std::vector<int>&               offsets,
+                       std::vector< SegmentBatch<T> >&       batches,
+                       int                                   batchSize
+                                                        = SEGMENT_BATCH_SIZE)
+{
+    int n = (int)offsets.size() - 1;
+    if (n <= 0)
+    {
+        batches.clear();
+        return;
+    }
+
+    // Batch whole polylines, about batchSize segments at a time.
+    int segments  = qMax(1, (int)vertices.size() - n);
+    int perBatch  = qMax(1, (int)((double)batchSize * n / segments));
+
+    batches.resize((n + perBatch - 1) / perBatch);
+
+    // A batch whose first polyline is empty starts from the infinite face.
+    std::vector<typename T::Face_handle> starts(batches.size());
+    for (unsigned int b=0; b<starts.size(); b++)
+    {
+        int first = offsets[b * perBatch];
+        starts[b] = first < offsets[b * perBatch + 1]
+                  ? dt->locate(vertices[first]) : dt->infinite_face();
+    }
+
+    SegmentBatchRunner<T> runner;
+    runner.dt        = dt;
+    runner.points    = &vertices[0];
+    runner.polylines = &offsets[0];
+    runner.starts    = &starts[0];
+    runner.batches   = &batches[0];
+    parallelChunks(n, perBatch, runner);
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,225 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Throughput of batched segment and polyline traversal queries.
+******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <boost/format.hpp>
+
+#include <QThreadPool>
+
+#include "benchmark.h"
+#include "segment_query.h"
+
+/*****************************************************************************/
+
+// Random walks inside the convex hull, starting from points of the
+// distribution, each step the given length in a uniformly random
+// direction. Steps that would leave the hull are redrawn.
+static void makePolylines(Delaunay*           dt,
+                          int                 distribution,
+                          int                 count,
+                          int                 length,
+                          double              step,
+                          unsigned int        seed,
+                          std::vector<Point>& vertices,
+                          std::vector<int>&   offsets)
+{
+    CGAL::Random random(seed);
+
+    vertices.clear();
+    offsets.assign(1, 0);
+
+    std::vector<Point> starts;
+    generatePoints(distribution, 4*count, seed, starts);
+
+    for (unsigned int i=0; i<starts.size() && (int)offsets.size()<=count; i++)
+    {
+        Face_handle f = dt->locate(starts[i]);
+        if (dt->is_infinite(f))
+            continue;
+
+        Point p = starts[i];
+        vertices.push_back(p);
+
+        for (int k=1, tries=0; k<length && tries < 64*length; tries++)
+        {
+            double angle = random.get_double(0, 2*M_PI);
+            Point  q(p.x() + step * std::cos(angle),
+                     p.y() + step * std::sin(angle));
+
+            Face_handle g = dt->locate(q, f);
+            if (dt->is_infinite(g))
+                continue;
+
+            vertices.push_back(q);
+            p = q;
+            f = g;
+            k++;
+        }
+
+        offsets.push_back(vertices.size());
+    }
+}
+
+/*****************************************************************************/
+
+// True if the batches hold the same faces, in the same order, as a.
+static bool sameFaces(const SegmentBatch<Delaunay>&                 a,
+                      const std::vector< SegmentBatch<Delaunay> >&  batches)
+{
+    unsigned int k = 0;
+    for (unsigned int b=0; b<batches.size(); b++)
+    {
+        const std::vector<Face_handle>& faces = batches[b].faces;
+        for (unsigned int i=0; i<faces.size(); i++, k++)
+            if (k >= a.faces.size() || a.faces[k] != faces[i])
+                return false;
+    }
+    return k == a.faces.size();
+}
+
+/*****************************************************************************/
+
+// Totals over a set of batches.
+struct BatchTotals
+{
+    double  segments;
+    double  faces;
+    double  orientations;
+    double  bytes;
+    int     unfinished;
+
+    BatchTotals(const std::vector< SegmentBatch<Delaunay> >& batches)
+        : segments(0), faces(0), orientations(0), bytes(0), unfinished(0)
+    {
+        for (unsigned int b=0; b<batches.size(); b++)
+        {
+            segments     += batches[b].numSegments();
+            faces        += batches[b].faces.size();
+            orientations += batches[b].orientations;
+            bytes        += batches[b].bytes();
+            unfinished   += batches[b].unfinished;
+        }
+    }
+};
+
+/*****************************************************************************/
+
+static void printRow(const char*                                    mode,
+                     int                                            threads,
+                     double                                         ns,
+                     const std::vector< SegmentBatch<Delaunay> >&   batches,
+                     const char*                                    same)
+{
+    BatchTotals t(batches);
+    double      s = qMax(1.0, t.segments);
+
+    std::cout << boost::format("%-10s %8d %10.1f %10.2f %12.2f %11.2f "
+                               "%10d %6s\n")
+                 % mode % threads % (ns / s) % (t.faces / s)
+                 % (t.orientations / s) % (t.bytes / qMax(1.0, t.faces))
+                 % t.unfinished % same;
+}
+
+/*****************************************************************************/
+
+// Time the faces crossed by random polylines, queried as the polylines
+// themselves and as a batch of separate segments. Segments are located
+// from scratch, or from the end of the previous segment, on one thread and
+// on the whole thread pool.
+//
+//  --segments       Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --queries        Number of segments.
+//  --length         Length of each segment, as a fraction of the radius of
+//                   the point distribution.
+//  --polyline       Number of vertices in each polyline.
+//  --batch          Segments per batch.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+int runSegmentBenchmark(const QStringList& args)
+{
+    QList<int>   sizes    = argIntList(args, "--n", "100000,1000000");
+    QList<int>   dists    = argDistributions(args);
+    int          queries  = argValue(args, "--queries",  "100000").toInt();
+    double       length   = argValue(args, "--length",   "0.01"  ).toDouble();
+    int          vertices = argValue(args, "--polyline", "100"   ).toInt();
+    int          batch    = argValue(args, "--batch",    "1024"  ).toInt();
+    unsigned int seed     = argValue(args, "--seed",     "1"     ).toUInt();
+    int          dist     = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+    int          cores    = QThread::idealThreadCount();
+
+    vertices = qMax(2, vertices);
+    batch    = qMax(1, batch);
+
+    silenceDebugOutput();
+
+    for (int s=0; s<sizes.size(); s++)
+    {
+        Delaunay dt;
+        buildTriangulation(&dt, dist, sizes[s], seed);
+
+        std::vector<Point> points;
+        std::vector<int>   offsets;
+        makePolylines(&dt, dist, (queries + vertices - 2) / (vertices - 1),
+                      vertices, length * GENERATOR_RADIUS, seed,
+                      points, offsets);
+
+        // The same segments, as pairs of endpoints.
+        std::vector<Point> endpoints;
+        for (unsigned int p=0; p+1<offsets.size(); p++)
+        {
+            for (int v=offsets[p]; v+1<offsets[p+1]; v++)
+            {
+                endpoints.push_back(points[v]);
+                endpoints.push_back(points[v+1]);
+            }
+        }
+
+        std::cout << boost::format("n = %d, %d segments in %d polylines\n")
+                     % sizes[s] % (endpoints.size() / 2)
+                     % (offsets.size() - 1);
+        std::cout << boost::format("%-10s %8s %10s %10s %12s %11s %10s %6s\n")
+                     % "mode" % "threads" % "ns/segment" % "faces/seg"
+                     % "orient/seg" % "bytes/face" % "unfinished" % "same";
+
+        // Every segment located from scratch. The reference for the others.
+        QElapsedTimer timer;
+        SegmentQuery<Delaunay>  query(&dt);
+        std::vector< SegmentBatch<Delaunay> > located(1);
+
+        timer.start();
+        for (unsigned int i=0; i+1<endpoints.size(); i+=2)
+            query.traverse(endpoints[i], endpoints[i+1], Face_handle(),
+                           located[0]);
+        printRow("located", 1, timer.nsecsElapsed(), located, "-");
+
+        int threads[2] = { 1, cores };
+
+        for (int t=0; t<2; t++)
+        {
+            QThreadPool::globalInstance()->setMaxThreadCount(threads[t]);
+
+            std::vector< SegmentBatch<Delaunay> > chained;
+            timer.start();
+            parallelSegments(&dt, endpoints, chained, batch);
+            printRow("chained", threads[t], timer.nsecsElapsed(), chained,
+                     sameFaces(located[0], chained) ? "yes" : "no");
+
+            std::vector< SegmentBatch<Delaunay> > polylines;
+            timer.start();
+            parallelPolylines(&dt, points, offsets, polylines, batch);
+            printRow("polyline", threads[t], timer.nsecsElapsed(), polylines,
+                     sameFaces(located[0], polylines) ? "yes" : "no");
+        }
+
+        QThreadPool::globalInstance()->setMaxThreadCount(cores);
+        std::cout << std::endl;
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
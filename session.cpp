@@ -0,0 +1,162 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Saving the state of the window, to reopen where it was left.
+*
+* The file is the magic number, the version and the size of the header,
+* then the header written with QDataStream, then the triangulation written
+* by CGAL in binary mode.
+*
+******************************************************************************/
+
+#include <cstring>
+#include <fstream>
+
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QByteArray>
+#include <QDataStream>
+#include <QDesktopServices>
+
+#include "session.h"
+
+/*****************************************************************************/
+
+static const char SESSION_MAGIC[4] = { 'W', 'S', 'E', 'S' };
+
+// Magic number, version and header size.
+static const int  SESSION_PREFIX   = 12;
+
+/*****************************************************************************/
+
+bool writeSession(const QString&      filename,
+                  const SessionState& state,
+                  const Delaunay*     dt)
+{
+    QByteArray  header;
+    QDataStream s(&header, QIODevice::WriteOnly);
+    s.setVersion(QDataStream::Qt_4_6);
+
+    s << state.transform << state.centre << state.sceneRect
+      << state.drawStraightWalk << state.drawVisibilityWalk
+      << state.drawPivotWalk << (qint32)state.inputPoints
+      << state.points[0] << state.points[1]
+      << (qint32)state.gridResolution << state.preview;
+
+    QByteArray  prefix;
+    QDataStream p(&prefix, QIODevice::WriteOnly);
+    p.writeRawData(SESSION_MAGIC, 4);
+    p << SESSION_VERSION << (quint32)header.size();
+
+    QFileInfo info(filename);
+    QDir().mkpath(info.absolutePath());
+
+    // Written beside the old session, which survives a failed write.
+    QString       partial = filename + ".part";
+    std::ofstream out(QFile::encodeName(partial).constData(),
+                      std::ios::out | std::ios::binary | std::ios::trunc);
+
+    out.write(prefix.constData(), prefix.size());
+    out.write(header.constData(), header.size());
+
+    CGAL::set_binary_mode(out);
+    out << *dt;
+    out.close();
+
+    if (out.fail())
+    {
+        QFile::remove(partial);
+        return false;
+    }
+
+    QFile::remove(filename);
+    return QFile::rename(partial, filename);
+}
+
+/*****************************************************************************/
+
+// Check the prefix of a session file, returning the size of its header, or
+// -1 if it is not a session of this version.
+static qint64 sessionHeaderSize(QFile& file)
+{
+    QByteArray prefix = file.read(SESSION_PREFIX);
+    if (prefix.size() != SESSION_PREFIX
+        || std::memcmp(prefix.constData(), SESSION_MAGIC, 4) != 0)
+        return -1;
+
+    QDataStream p(prefix);
+    p.skipRawData(4);
+
+    quint32 version, size;
+    p >> version >> size;
+
+    return version == SESSION_VERSION ? size : -1;
+}
+
+/*****************************************************************************/
+
+bool readSessionState(const QString& filename, SessionState& state)
+{
+    QFile file(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    qint64 size = sessionHeaderSize(file);
+    if (size < 0)
+        return false;
+
+    QByteArray header = file.read(size);
+    if (header.size() != size)
+        return false;
+
+    QDataStream s(header);
+    s.setVersion(QDataStream::Qt_4_6);
+
+    qint32 inputPoints, gridResolution;
+    s >> state.transform >> state.centre >> state.sceneRect
+      >> state.drawStraightWalk >> state.drawVisibilityWalk
+      >> state.drawPivotWalk >> inputPoints
+      >> state.points[0] >> state.points[1]
+      >> gridResolution >> state.preview;
+
+    state.inputPoints    = inputPoints;
+    state.gridResolution = gridResolution;
+
+    return s.status() == QDataStream::Ok;
+}
+
+/*****************************************************************************/
+
+bool readSessionTriangulation(const QString& filename, Delaunay* dt)
+{
+    qint64 size;
+    {
+        QFile file(filename);
+        if (!file.open(QIODevice::ReadOnly))
+            return false;
+
+        size = sessionHeaderSize(file);
+        if (size < 0)
+            return false;
+    }
+
+    std::ifstream in(QFile::encodeName(filename).constData(),
+                     std::ios::in | std::ios::binary);
+    in.seekg(SESSION_PREFIX + size);
+
+    CGAL::set_binary_mode(in);
+    in >> *dt;
+
+    return !in.fail();
+}
+
+/*****************************************************************************/
+
+QString defaultSessionFile()
+{
+    QString dir = QDesktopServices::storageLocation(
+                                            QDesktopServices::DataLocation);
+    return QDir(dir).filePath("session.wvs");
+}
+
+/*****************************************************************************/
@@ -0,0 +1,78 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Saving the state of the window, to reopen where it was left.
+*
+* A session file starts with a small header: the view, the walks selected,
+* their endpoints, the grid resolution, and a picture of the view as it was
+* last drawn. The triangulation follows in CGAL's binary format. That format
+* holds the faces and their neighbours, so reading it back does not redo the
+* Delaunay insertion. The header can be read on its own, which lets the
+* window show the picture at once and load the triangulation in the
+* background.
+*
+******************************************************************************/
+
+#ifndef SESSION_H
+#define SESSION_H
+
+/*****************************************************************************/
+
+#include <QImage>
+#include <QPoint>
+#include <QPointF>
+#include <QRectF>
+#include <QString>
+#include <QTransform>
+
+#include "mainwindow.h"
+
+/*****************************************************************************/
+
+// Bumped whenever the layout of the file changes. Older files are ignored.
+const quint32 SESSION_VERSION = 1;
+
+/*****************************************************************************/
+
+struct SessionState
+{
+    QTransform                      transform;  // View scale, without scroll.
+    QPointF                         centre;     // Scene point in the middle.
+    QRectF                          sceneRect;
+
+    bool                            drawStraightWalk;
+    bool                            drawVisibilityWalk;
+    bool                            drawPivotWalk;
+
+    // As in MainWindow: -1 when no walk was being drawn.
+    int                             inputPoints;
+    QPoint                          points[2];
+
+    int                             gridResolution;
+    QImage                          preview;    // The view as last drawn.
+};
+
+/*****************************************************************************/
+
+// Write the state and the triangulation to filename, replacing it only once
+// the whole session is written. Nothing may change dt until this returns,
+// but it may be read; this is meant to run on the thread pool.
+bool            writeSession(const QString&      filename,
+                             const SessionState& state,
+                             const Delaunay*     dt);
+
+// Read the header of a session file.
+bool            readSessionState(const QString& filename,
+                                 SessionState&  state);
+
+// Read the triangulation of a session file into dt.
+bool            readSessionTriangulation(const QString& filename,
+                                         Delaunay*      dt);
+
+// Where the window keeps its session between runs.
+QString         defaultSessionFile();
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
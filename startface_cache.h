@@ -0,0 +1,213 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* A cache of where recent walks ended, used to start new walks.
+*
+* The plane is cut into square cells, hashed into a fixed size table, and
+* each slot remembers the face the last walk to a point in one of its cells
+* ended in. Queries with locality then start next to their target. The
+* cache is shared by all threads without locks: slots are read and written
+* with relaxed atomics, and a lost update only costs a longer walk.
+*
+* Every face in the cache must still exist. Changing the triangulation
+* destroys faces, so invalidate() starts a new generation, and slots
+* written in an older one are ignored.
+*
+******************************************************************************/
+
+#ifndef STARTFACE_CACHE_H
+#define STARTFACE_CACHE_H
+
+/*****************************************************************************/
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+#include "walk.h"
+
+/*****************************************************************************/
+
+// Average number of vertices per cell when no cell size is given.
+const int CACHE_POINTS_PER_CELL = 16;
+
+// Largest number of slots in the table, as a power of two.
+const int CACHE_MAX_SLOTS_LOG2  = 16;
+
+/*****************************************************************************/
+
+template <typename T>
+class StartFaceCache : public StartFaceOracle<T>
+{
+    typedef typename T::Face                            Face;
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Finite_vertices_iterator        Finite_vertices_iterator;
+    typedef typename T::Triangulation_data_structure::Face_range
+                                                        Face_range;
+
+    struct Slot
+    {
+        QAtomicPointer<Face>        face;
+        QAtomicInt                  generation;
+    };
+
+public:
+    // Misses go to the fallback oracle if there is one, and otherwise to
+    // the infinite face. A cell size of 0 picks one from the number of
+    // vertices.
+                                    StartFaceCache(T* dt,
+                                        StartFaceOracle<T>* fallback = 0,
+                                        double cellSize = 0);
+
+    // Forget every cached face, after the triangulation has changed.
+    void                            invalidate();
+
+    // The cached face for the cell of p, if there is one.
+    bool                            lookup(const Point& p,
+                                           Face_handle& f) const;
+
+    // Remember that a walk to p ended in f.
+    void                            record(const Point& p, Face_handle f);
+
+    Face_handle                     startFace(const Point& p);
+    void                            walkEnded(const Point& p, Face_handle f);
+
+    int                             numSlots() const { return slots.size(); }
+
+private:
+    int                             slotOf(const Point& p) const;
+
+    T*                              dt;
+    StartFaceOracle<T>*             fallback;
+    double                          cell;
+    unsigned int                    mask;
+    QAtomicInt                      generation;
+    std::vector<Slot>               slots;
+};
+
+/*****************************************************************************/
+
+template <typename T>
+StartFaceCache<T>::StartFaceCache(T*                  dt,
+                                  StartFaceOracle<T>* fallback,
+                                  double              cellSize)
+{
+    this->dt       = dt;
+    this->fallback = fallback;
+    generation     = 1;
+
+    // Size cells from the density of the bounding box.
+    int n = dt->number_of_vertices();
+    if (cellSize <= 0 && n > 0)
+    {
+        double min_x, min_y, max_x, max_y;
+        Finite_vertices_iterator v = dt->finite_vertices_begin();
+        min_x = max_x = v->point().x();
+        min_y = max_y = v->point().y();
+        for (; v != dt->finite_vertices_end(); ++v)
+        {
+            min_x = std::min(min_x, (double)v->point().x());
+            min_y = std::min(min_y, (double)v->point().y());
+            max_x = std::max(max_x, (double)v->point().x());
+            max_y = std::max(max_y, (double)v->point().y());
+        }
+
+        double area = std::max((max_x - min_x) * (max_y - min_y), 1e-24);
+        cellSize    = std::sqrt(area * CACHE_POINTS_PER_CELL / n);
+    }
+    cell = cellSize > 0 ? cellSize : 1;
+
+    // About one slot per cell, up to the limit.
+    int bits = 0;
+    while (bits < CACHE_MAX_SLOTS_LOG2
+           && (1 << bits) * CACHE_POINTS_PER_CELL < n)
+        bits++;
+
+    slots = std::vector<Slot>(1 << bits);
+    mask  = (1u << bits) - 1;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void StartFaceCache<T>::invalidate()
+{
+    generation.fetchAndAddRelaxed(1);
+}
+
+/*****************************************************************************/
+
+template <typename T>
+int StartFaceCache<T>::slotOf(const Point& p) const
+{
+    // Clamp before converting, far away points would overflow an int.
+    double x = std::max(-1e9, std::min(1e9, std::floor(p.x() / cell)));
+    double y = std::max(-1e9, std::min(1e9, std::floor(p.y() / cell)));
+
+    unsigned int h = (unsigned int)(int)x * 73856093u
+                   ^ (unsigned int)(int)y * 19349663u;
+    return h & mask;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+bool StartFaceCache<T>::lookup(const Point& p, Face_handle& f) const
+{
+    const Slot& s = slots[slotOf(p)];
+
+    // Plain reads of the atomics are relaxed loads. The generation is
+    // stored after the face, so a slot of the current generation holds a
+    // face recorded in it.
+    if ((int)s.generation != (int)generation)
+        return false;
+
+    Face* face = s.face;
+    if (!face)
+        return false;
+
+    f = Face_range::s_iterator_to(*face);
+    return true;
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void StartFaceCache<T>::record(const Point& p, Face_handle f)
+{
+    if (f == Face_handle() || dt->is_infinite(f))
+        return;
+
+    Slot& s = slots[slotOf(p)];
+    s.face.fetchAndStoreRelaxed(&*f);
+    s.generation.fetchAndStoreRelease(generation);
+}
+
+/*****************************************************************************/
+
+template <typename T>
+typename T::Face_handle StartFaceCache<T>::startFace(const Point& p)
+{
+    Face_handle f;
+    if (lookup(p, f))
+        return f;
+
+    return fallback ? fallback->startFace(p) : dt->infinite_face();
+}
+
+/*****************************************************************************/
+
+template <typename T>
+void StartFaceCache<T>::walkEnded(const Point& p, Face_handle f)
+{
+    record(p, f);
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,486 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Differential stress test of the walks against the triangulation's own
+* locate, on random and degenerate queries.
+*
+* A walk is correct if it ends in a face containing its target. Inside a
+* face that is the face locate() returns, but a target on an edge or a
+* vertex is in several faces, and any of them will do. Each walk is checked
+* against locate() and, where they differ, against the closed face it ended
+* in. Faces are those of the walk's trace: the last one for the visibility
+* and pivot walks, and the first one containing the target for the straight
+* walk, which runs on past it.
+*
+******************************************************************************/
+
+#include <cmath>
+#include <algorithm>
+#include <iostream>
+#include <exception>
+#include <boost/format.hpp>
+
+#include "benchmark.h"
+
+/*****************************************************************************/
+
+// Walks handed to each thread at a time.
+const int STRESS_BATCH_SIZE = 1024;
+
+/*****************************************************************************/
+
+// Kinds of query. Degenerate queries are exactly on vertices, on edges or
+// on the lines through edges when coordinates are on a lattice, and within
+// rounding of them otherwise.
+enum StressQuery
+{
+    QUERY_RANDOM = 0,
+    QUERY_VERTEX,
+    QUERY_EDGE,
+    QUERY_COLLINEAR,
+    NUM_QUERY_KINDS
+};
+
+static const char* queryName(int kind)
+{
+    switch (kind)
+    {
+        case QUERY_RANDOM:    return "random";
+        case QUERY_VERTEX:    return "vertex";
+        case QUERY_EDGE:      return "edge";
+        case QUERY_COLLINEAR: return "collinear";
+        default:              return "unknown";
+    }
+}
+
+/*****************************************************************************/
+
+// How a walk compared with locate().
+enum StressResult
+{
+    STRESS_SAME = 0,        // The same face.
+    STRESS_EQUIVALENT,      // Another face that also contains the target.
+    STRESS_WRONG_FACE,      // A face that does not contain the target.
+    STRESS_NO_FACE,         // Gave up, or never reached the target.
+    STRESS_EXCEPTION,       // A precondition or assertion failed.
+    NUM_STRESS_RESULTS
+};
+
+static const char* resultName(int result)
+{
+    switch (result)
+    {
+        case STRESS_SAME:       return "same";
+        case STRESS_EQUIVALENT: return "equivalent";
+        case STRESS_WRONG_FACE: return "wrong face";
+        case STRESS_NO_FACE:    return "no face";
+        case STRESS_EXCEPTION:  return "exception";
+        default:                return "unknown";
+    }
+}
+
+/*****************************************************************************/
+
+// A walk that went wrong, with what is needed to repeat it.
+struct StressFailure
+{
+    unsigned int    seed;
+    int             distribution;
+    bool            lattice;
+    int             n;
+    int             strategy;
+    int             query;
+    int             kind;
+    int             result;
+    Point           target;
+};
+
+/*****************************************************************************/
+
+// True if p is in the closed face f. An infinite face holds the points that
+// see its hull edge, and the points on that edge.
+static bool faceContains(Delaunay* dt, Face_handle f, const Point& p)
+{
+    if (f == Face_handle())
+        return false;
+
+    if (dt->is_infinite(f))
+    {
+        // The face is (inf, a, b) counter-clockwise, so the outside of the
+        // hull is to the left of a->b.
+        int          i = f->index(dt->infinite_vertex());
+        const Point& a = f->vertex(f->ccw(i))->point();
+        const Point& b = f->vertex(f->cw(i))->point();
+
+        CGAL::Orientation o = dt->orientation(a, b, p);
+        return o == CGAL::LEFT_TURN
+            || (o == CGAL::COLLINEAR
+                && CGAL::collinear_are_ordered_along_line(a, p, b));
+    }
+
+    for (int i=0; i<3; i++)
+        if (dt->orientation(f->vertex(f->ccw(i))->point(),
+                            f->vertex(f->cw(i))->point(), p)
+                                                        == CGAL::RIGHT_TURN)
+            return false;
+    return true;
+}
+
+/*****************************************************************************/
+
+// The face each kind of walk ended in, or null if it did not finish.
+static Face_handle endFace(Delaunay*                       dt,
+                           const StraightWalk<Delaunay>&   w,
+                           const Point&                    p)
+{
+    const CompactTrace<Delaunay>& trace = w.getTrace();
+
+    CompactTrace<Delaunay>::const_iterator i;
+    for (i = trace.begin(); i != trace.end(); ++i)
+        if (faceContains(dt, *i, p))
+            return *i;
+
+    return Face_handle();
+}
+
+static Face_handle endFace(Delaunay*,
+                           const VisibilityWalk<Delaunay>& w,
+                           const Point&)
+{
+    return w.getTrace().size() > 0 ? w.getTrace().back() : Face_handle();
+}
+
+static Face_handle endFace(Delaunay*,
+                           const PivotWalk<Delaunay>&      w,
+                           const Point&)
+{
+    if (!w.getStatistics().completed || w.getTrace().size() == 0)
+        return Face_handle();
+
+    return w.getTrace().back();
+}
+
+/*****************************************************************************/
+
+// Walks a range of the queries with walks of type W, keeping the face each
+// one ended in. Walks are seeded by query, so runs repeat exactly.
+template <typename W>
+struct StressWalker
+{
+    Delaunay*                       dt;
+    const Point*                    targets;
+    const Face_handle*              starts;
+    Face_handle*                    ends;
+    char*                           threw;
+
+    void operator()(int, int begin, int end)
+    {
+        for (int i=begin; i<end; i++)
+        {
+            threw[i] = false;
+            try
+            {
+                W w(targets[i], dt, starts[i], i);
+                ends[i] = endFace(dt, w, targets[i]);
+            }
+            catch (std::exception&)
+            {
+                ends[i]  = Face_handle();
+                threw[i] = true;
+            }
+        }
+    }
+};
+
+/*****************************************************************************/
+
+// Queries of every kind, inside the convex hull or on it. Walks start from
+// the face of another random point, or for one in eight from the infinite
+// face, as they do when not given one.
+static void makeStressQueries(Delaunay*                 dt,
+                              int                       count,
+                              unsigned int              seed,
+                              std::vector<Point>&       targets,
+                              std::vector<Face_handle>& starts,
+                              std::vector<int>&         kinds)
+{
+    targets.clear();
+    starts.clear();
+    kinds.clear();
+
+    Delaunay::Finite_vertices_iterator v = dt->finite_vertices_begin();
+    double x0 = v->point().x(), x1 = x0;
+    double y0 = v->point().y(), y1 = y0;
+    for (; v != dt->finite_vertices_end(); ++v)
+    {
+        x0 = std::min(x0, v->point().x());
+        x1 = std::max(x1, v->point().x());
+        y0 = std::min(y0, v->point().y());
+        y1 = std::max(y1, v->point().y());
+    }
+
+    CGAL::Random random(seed);
+
+    for (int tries=0; (int)targets.size() < count && tries < 16*count;
+                                                                    tries++)
+    {
+        Point       any(random.get_double(x0, x1), random.get_double(y0, y1));
+        Face_handle f    = dt->locate(any);
+        int         kind = random.get_int(0, NUM_QUERY_KINDS);
+        int         i    = random.get_int(0, 3);
+        bool        flip = random.get_bool();
+
+        if (dt->is_infinite(f))
+            continue;
+
+        const Point& a = f->vertex(f->ccw(i))->point();
+        const Point& b = f->vertex(f->cw(i))->point();
+
+        Point p = any;
+        if (kind == QUERY_VERTEX)
+            p = f->vertex(i)->point();
+        else if (kind == QUERY_EDGE)
+            p = CGAL::midpoint(a, b);
+        else if (kind == QUERY_COLLINEAR)
+        {
+            // Beyond one end of the edge, by its length.
+            p = flip ? Point(2*a.x() - b.x(), 2*a.y() - b.y())
+                     : Point(2*b.x() - a.x(), 2*b.y() - a.y());
+
+            Delaunay::Locate_type lt;
+            int                   li;
+            dt->locate(p, lt, li);
+            if (lt == Delaunay::OUTSIDE_CONVEX_HULL)
+                continue;
+        }
+
+        Point       from(random.get_double(x0, x1), random.get_double(y0, y1));
+        Face_handle s = random.get_int(0, 8) == 0 ? Face_handle()
+                                                  : dt->locate(from);
+
+        targets.push_back(p);
+        starts.push_back(s);
+        kinds.push_back(kind);
+    }
+}
+
+/*****************************************************************************/
+
+// Totals for one strategy over every round of one input.
+struct StressTotals
+{
+    long long                       queries;
+    double                          ns;
+    long long                       results[NUM_STRESS_RESULTS];
+};
+
+/*****************************************************************************/
+
+// Run walks of type W on every query, in parallel, and compare each end face
+// with the reference.
+template <typename W>
+static void stressStrategy(Delaunay*                        dt,
+                           int                              strategy,
+                           const std::vector<Point>&        targets,
+                           const std::vector<Face_handle>&  starts,
+                           const std::vector<int>&          kinds,
+                           const std::vector<Face_handle>&  reference,
+                           StressFailure                    where,
+                           StressTotals&                    totals,
+                           std::vector<StressFailure>&      failures)
+{
+    int                      n = targets.size();
+    std::vector<Face_handle> ends(n);
+    std::vector<char>        threw(n);
+
+    StressWalker<W> walker;
+    walker.dt      = dt;
+    walker.targets = &targets[0];
+    walker.starts  = &starts[0];
+    walker.ends    = &ends[0];
+    walker.threw   = &threw[0];
+
+    QElapsedTimer timer;
+    timer.start();
+    parallelChunks(n, STRESS_BATCH_SIZE, walker);
+    totals.ns      += timer.nsecsElapsed();
+    totals.queries += n;
+
+    for (int i=0; i<n; i++)
+    {
+        int result = threw[i]                           ? STRESS_EXCEPTION
+                   : ends[i] == Face_handle()           ? STRESS_NO_FACE
+                   : ends[i] == reference[i]            ? STRESS_SAME
+                   : faceContains(dt, ends[i], targets[i])
+                                                        ? STRESS_EQUIVALENT
+                                                        : STRESS_WRONG_FACE;
+        totals.results[result]++;
+
+        if (result == STRESS_SAME || result == STRESS_EQUIVALENT)
+            continue;
+
+        where.strategy = strategy;
+        where.query    = i;
+        where.kind     = kinds[i];
+        where.result   = result;
+        where.target   = targets[i];
+        failures.push_back(where);
+    }
+}
+
+/*****************************************************************************/
+
+// Every round of one distribution and size, raw or snapped to a lattice,
+// printing a row per strategy.
+static void stressInput(int                         distribution,
+                        bool                        lattice,
+                        int                         n,
+                        int                         queries,
+                        int                         rounds,
+                        unsigned int                seed,
+                        std::vector<StressFailure>& failures)
+{
+    StressTotals totals[NUM_STRATEGIES];
+    for (int w=0; w<NUM_STRATEGIES; w++)
+    {
+        totals[w].queries = 0;
+        totals[w].ns      = 0;
+        for (int r=0; r<NUM_STRESS_RESULTS; r++)
+            totals[w].results[r] = 0;
+    }
+
+    for (int round=0; round<rounds; round++)
+    {
+        std::vector<Point> points;
+        generatePoints(distribution, n, seed + round, points);
+
+        // About one lattice step per point along each side.
+        if (lattice)
+        {
+            int e;
+            std::frexp(2 * GENERATOR_RADIUS / std::sqrt(n + 1.), &e);
+
+            double step = std::ldexp(1., e - 1);
+            for (unsigned int i=0; i<points.size(); i++)
+                points[i] = Point(step * std::floor(points[i].x() / step),
+                                  step * std::floor(points[i].y() / step));
+        }
+
+        Delaunay dt;
+        dt.insert(points.begin(), points.end());
+        if (dt.dimension() < 2)
+            continue;
+
+        std::vector<Point>       targets;
+        std::vector<Face_handle> starts;
+        std::vector<int>         kinds;
+        makeStressQueries(&dt, queries, seed + round, targets, starts, kinds);
+        if (targets.empty())
+            continue;
+
+        // The reference is found serially, locate() is not reentrant.
+        std::vector<Face_handle> reference(targets.size());
+        for (unsigned int i=0; i<targets.size(); i++)
+            reference[i] = dt.locate(targets[i]);
+
+        StressFailure where;
+        where.seed         = seed + round;
+        where.distribution = distribution;
+        where.lattice      = lattice;
+        where.n            = n;
+
+        stressStrategy< StraightWalk<Delaunay> >
+            (&dt, STRAIGHT_WALK, targets, starts, kinds, reference, where,
+             totals[STRAIGHT_WALK], failures);
+        stressStrategy< VisibilityWalk<Delaunay> >
+            (&dt, VISIBILITY_WALK, targets, starts, kinds, reference, where,
+             totals[VISIBILITY_WALK], failures);
+        stressStrategy< PivotWalk<Delaunay> >
+            (&dt, PIVOT_WALK, targets, starts, kinds, reference, where,
+             totals[PIVOT_WALK], failures);
+    }
+
+    QString input = QString("%1/%2").arg(distributionName(distribution))
+                                    .arg(lattice ? "lattice" : "raw");
+
+    for (int w=0; w<NUM_STRATEGIES; w++)
+    {
+        const StressTotals& t = totals[w];
+        double              q = qMax(1LL, t.queries);
+
+        std::cout << boost::format("%-18s %8d %-10s %9d %10.1f %8.2f %8.2f "
+                                   "%8.2f %8d\n")
+                     % input.toStdString() % n % strategyName(w)
+                     % t.queries % (t.ns / q)
+                     % (t.queries / qMax(1.0, t.ns) * 1e3)
+                     % (100 * t.results[STRESS_SAME]       / q)
+                     % (100 * t.results[STRESS_EQUIVALENT] / q)
+                     % (t.queries - t.results[STRESS_SAME]
+                                  - t.results[STRESS_EQUIVALENT]);
+    }
+}
+
+/*****************************************************************************/
+
+// Fire random and degenerate queries at every walk, in parallel, and check
+// that each ends in a face containing its target, as found by
+// Delaunay::locate(). Each pointset is also snapped to a lattice of a power
+// of two, on which the degenerate queries are exact, and which has many
+// collinear and cocircular points.
+//
+//  --stress         Select this mode.
+//  --n              Comma separated list of triangulation sizes.
+//  --queries        Number of queries per round.
+//  --rounds         Number of rounds, each with its own pointset and
+//                   queries. Round r uses seed + r.
+//  --seed           Seed of the first round.
+//  --distributions  Comma separated list of distribution names, or "all".
+//  --show           Most failures to list.
+//
+// Failures are listed with the seed of their round and the options that
+// repeat it. Returns 1 if there were any.
+int runStressTest(const QStringList& args)
+{
+    QList<int>   sizes   = argIntList(args, "--n", "1000,100000");
+    QList<int>   dists   = argDistributions(args);
+    int          queries = argValue(args, "--queries", "20000").toInt();
+    int          rounds  = argValue(args, "--rounds",  "4"    ).toInt();
+    unsigned int seed    = argValue(args, "--seed",    "1"    ).toUInt();
+    int          show    = argValue(args, "--show",    "20"   ).toInt();
+
+    std::vector<StressFailure> failures;
+
+    silenceDebugOutput();
+
+    std::cout << boost::format("%-18s %8s %-10s %9s %10s %8s %8s %8s %8s\n")
+                 % "input" % "n" % "strategy" % "queries" % "ns/query"
+                 % "Mq/s" % "same %" % "other %" % "failed";
+
+    for (int d=0; d<dists.size(); d++)
+        for (int lattice=0; lattice<2; lattice++)
+            for (int s=0; s<sizes.size(); s++)
+                stressInput(dists[d], lattice, sizes[s], queries, rounds,
+                            seed, failures);
+
+    for (int i=0; i<(int)failures.size() && i<show; i++)
+    {
+        const StressFailure& f = failures[i];
+
+        std::cout << boost::format("\n%s walk, %s query %d at "
+                                   "(%.17g, %.17g): %s\n"
+                                   "  repeat with: --stress --n %d "
+                                   "--distributions %s --seed %u "
+                                   "--rounds 1 (%s points)\n")
+                     % strategyName(f.strategy) % queryName(f.kind)
+                     % f.query % f.target.x() % f.target.y()
+                     % resultName(f.result) % f.n
+                     % distributionName(f.distribution) % f.seed
+                     % (f.lattice ? "lattice" : "raw");
+    }
+
+    if (!failures.empty())
+        std::cout << boost::format("\n%d failed walks.\n") % failures.size();
+
+    return failures.empty() ? 0 : 1;
+}
+
+/*****************************************************************************/
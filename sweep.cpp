@@ -0,0 +1,339 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Scaling sweep of walk cost against n and the length of the walk.
+*
+* For points of roughly uniform density, a walk of length d crosses about
+* d * sqrt(n) triangles, so each measure of cost should fit
+*
+*     cost = a * d * sqrt(n) + b
+*
+* where b is the overhead of a walk that goes nowhere. The sweep measures
+* every strategy over a grid of n and d, and fits a and b by least squares.
+*
+******************************************************************************/
+
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <boost/format.hpp>
+
+#include "benchmark.h"
+#include "parallel.h"
+#include "walk_stepper.h"
+
+/*****************************************************************************/
+
+// One cell of the sweep: a strategy at a given n and walk length.
+struct SweepResult
+{
+    int         strategy;
+    int         n;
+    double      distance;
+    int         queries;
+    WalkCost    cost;
+};
+
+/*****************************************************************************/
+
+// Queries whose start and target are a fixed distance apart, both inside
+// the convex hull. Starts follow the point distribution, the direction to
+// the target is uniform.
+static void makeQueriesAtDistance(Delaunay*                 dt,
+                                  int                       distribution,
+                                  int                       count,
+                                  double                    distance,
+                                  unsigned int              seed,
+                                  std::vector<Point>&       targets,
+                                  std::vector<Face_handle>& starts)
+{
+    CGAL::Random random(seed);
+    std::vector<Point> candidates;
+
+    targets.clear();
+    starts.clear();
+
+    for (int round=0; (int)targets.size() < count && round < 16; round++)
+    {
+        generatePoints(distribution, count, seed + 7919*(round+1), candidates);
+
+        for (unsigned int i=0; i<candidates.size(); i++)
+        {
+            double angle = random.get_double(0, 2*M_PI);
+            Point  t(candidates[i].x() + distance * std::cos(angle),
+                     candidates[i].y() + distance * std::sin(angle));
+
+            Face_handle s = dt->locate(candidates[i]);
+            if (dt->is_infinite(s) || dt->is_infinite(dt->locate(t, s)))
+                continue;
+
+            starts.push_back(s);
+            targets.push_back(t);
+
+            if ((int)targets.size() == count)
+                break;
+        }
+    }
+}
+
+/*****************************************************************************/
+
+// Time straight walks that stop at the face containing their target. The
+// straight walk of walk.h follows the line on to the convex hull, so its
+// cost hardly depends on d; the stepper stops where the other walks do.
+// Each step enters one face.
+static WalkCost measureStraightSteps(Delaunay*                       dt,
+                                     const std::vector<Point>&       targets,
+                                     const std::vector<Face_handle>& starts)
+{
+    WalkCost cost = {0, 0, 0, 0, 0, 0};
+    if (targets.empty())
+        return cost;
+
+    long long orientations = 0;
+    long long triangles    = 0;
+
+    QElapsedTimer timer;
+    timer.start();
+
+    for (unsigned int i=0; i<targets.size(); i++)
+    {
+        StraightStepper<Delaunay> w(targets[i], dt, starts[i], i);
+        while (!w.done())
+        {
+            w.step();
+            triangles++;
+        }
+        orientations += w.getNumOrientationsPerformed();
+    }
+
+    cost.ns           = timer.nsecsElapsed() / (double)targets.size();
+    cost.orientations = orientations         / (double)targets.size();
+    cost.triangles    = triangles            / (double)targets.size();
+
+    return cost;
+}
+
+/*****************************************************************************/
+
+// Builds the triangulation for each n and measures every strategy and
+// distance on it. Each sweep point writes only to its own results.
+struct SweepPoint
+{
+    const QList<int>*                   sizes;
+    const QList<double>*                distances;
+    std::vector<SweepResult>*           results;
+    int                                 distribution;
+    int                                 queries;
+    unsigned int                        seed;
+
+    void operator()(int, int begin, int end)
+    {
+        for (int s=begin; s<end; s++)
+            run(s);
+    }
+
+    void run(int s)
+    {
+        int n = (*sizes)[s];
+
+        Delaunay dt;
+        buildTriangulation(&dt, distribution, n, seed + s);
+
+        for (int d=0; d<distances->size(); d++)
+        {
+            double distance = (*distances)[d] * GENERATOR_RADIUS;
+
+            std::vector<Point>       targets;
+            std::vector<Face_handle> starts;
+            makeQueriesAtDistance(&dt, distribution, queries, distance,
+                                  seed + 101*s + d, targets, starts);
+
+            for (int strategy=0; strategy<NUM_STRATEGIES; strategy++)
+            {
+                SweepResult r;
+                r.strategy = strategy;
+                r.n        = n;
+                r.distance = (*distances)[d];
+                r.queries  = targets.size();
+
+                switch (strategy)
+                {
+                    case STRAIGHT_WALK:
+                        r.cost = measureStraightSteps(&dt, targets, starts);
+                        break;
+                    case VISIBILITY_WALK:
+                        r.cost = measureWalks< VisibilityWalk<Delaunay> >
+                                     (&dt, targets, starts);
+                        break;
+                    case PIVOT_WALK:
+                    default:
+                        r.cost = measureWalks< PivotWalk<Delaunay> >
+                                     (&dt, targets, starts);
+                        break;
+                }
+
+                results[s].push_back(r);
+            }
+        }
+    }
+};
+
+/*****************************************************************************/
+
+// Least squares fit of y = a*x + b, with the coefficient of determination.
+static void fitLine(const std::vector<double>& x,
+                    const std::vector<double>& y,
+                    double&                    a,
+                    double&                    b,
+                    double&                    r2)
+{
+    double n = x.size(), sx = 0, sy = 0, sxx = 0, sxy = 0;
+    for (unsigned int i=0; i<x.size(); i++)
+    {
+        sx  += x[i];
+        sy  += y[i];
+        sxx += x[i]*x[i];
+        sxy += x[i]*y[i];
+    }
+
+    double det = n*sxx - sx*sx;
+    a  = det == 0 ? 0 : (n*sxy - sx*sy) / det;
+    b  = n   == 0 ? 0 : (sy - a*sx) / n;
+
+    double mean = n == 0 ? 0 : sy / n, ssTotal = 0, ssResidual = 0;
+    for (unsigned int i=0; i<x.size(); i++)
+    {
+        double e    = y[i] - (a*x[i] + b);
+        ssTotal    += (y[i] - mean) * (y[i] - mean);
+        ssResidual += e * e;
+    }
+    r2 = ssTotal == 0 ? 1 : 1 - ssResidual / ssTotal;
+}
+
+/*****************************************************************************/
+
+// Measure every strategy over a geometric sequence of n and a list of walk
+// lengths, and fit cost = a * d * sqrt(n) + b for each strategy. Straight
+// walks are measured up to the face containing the target, not to the hull.
+//
+//  --sweep          Select this mode.
+//  --n-min          Smallest triangulation.
+//  --n-max          Largest triangulation.
+//  --factor         Ratio between consecutive triangulation sizes.
+//  --distances      Comma separated walk lengths, as fractions of the
+//                   radius of the point distribution.
+//  --queries        Number of queries per strategy, n and distance.
+//  --seed           Seed for the pointsets and the queries.
+//  --distributions  Name of the point distribution (the first one is used).
+//  --csv            Write every measurement to this file.
+//
+// Sweep points are measured concurrently, one triangulation per thread, so
+// their timings include contention for memory bandwidth. Counts are exact.
+int runSweep(const QStringList& args)
+{
+    int          nMin    = argValue(args, "--n-min",   "1000"   ).toInt();
+    int          nMax    = argValue(args, "--n-max",   "1000000").toInt();
+    double       factor  = argValue(args, "--factor",  "4"      ).toDouble();
+    int          queries = argValue(args, "--queries", "1000"   ).toInt();
+    unsigned int seed    = argValue(args, "--seed",    "1"      ).toUInt();
+    QString      csvFile = argValue(args, "--csv");
+    QList<int>   dists   = argDistributions(args);
+
+    QList<double> distances;
+    QStringList items = argValue(args, "--distances",
+                                 "0.01,0.05,0.1,0.25,0.5").split(",");
+    for (int i=0; i<items.size(); i++)
+        distances.append(items[i].toDouble());
+
+    QList<int> sizes;
+    for (double n=nMin; n <= nMax && factor > 1; n *= factor)
+        sizes.append((int)(n + 0.5));
+
+    if (sizes.isEmpty() || distances.isEmpty())
+    {
+        std::cerr << "Nothing to sweep" << std::endl;
+        return 1;
+    }
+
+    silenceDebugOutput();
+
+    std::vector< std::vector<SweepResult> > results(sizes.size());
+
+    SweepPoint point;
+    point.sizes        = &sizes;
+    point.distances    = &distances;
+    point.results      = &results[0];
+    point.distribution = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+    point.queries      = queries;
+    point.seed         = seed;
+    parallelChunks(sizes.size(), 1, point);
+
+    std::ofstream csv;
+    if (!csvFile.isEmpty())
+    {
+        csv.open(csvFile.toStdString().c_str());
+        csv << "strategy,n,distance,queries,ns,orientations,triangles\n";
+    }
+
+    std::cout << boost::format("%-12s %10s %9s %10s %12s %10s\n")
+                 % "strategy" % "n" % "distance" % "ns/query"
+                 % "orient/query" % "tri/query";
+
+    for (unsigned int s=0; s<results.size(); s++)
+    {
+        for (unsigned int k=0; k<results[s].size(); k++)
+        {
+            const SweepResult& r = results[s][k];
+
+            std::cout << boost::format("%-12s %10d %9.3f %10.1f %12.2f "
+                                       "%10.2f\n")
+                         % strategyName(r.strategy) % r.n % r.distance
+                         % r.cost.ns % r.cost.orientations % r.cost.triangles;
+
+            if (csv.is_open())
+                csv << strategyName(r.strategy) << "," << r.n << ","
+                    << r.distance << "," << r.queries << "," << r.cost.ns
+                    << "," << r.cost.orientations << "," << r.cost.triangles
+                    << "\n";
+        }
+    }
+
+    // Fit each measure of cost against d * sqrt(n).
+    std::cout << "\n"
+              << boost::format("%-12s %-13s %12s %12s %8s\n")
+                 % "strategy" % "measure" % "a" % "b" % "r^2";
+
+    const char* measures[3] = { "ns", "orientations", "triangles" };
+
+    for (int strategy=0; strategy<NUM_STRATEGIES; strategy++)
+    {
+        for (int m=0; m<3; m++)
+        {
+            std::vector<double> x, y;
+            for (unsigned int s=0; s<results.size(); s++)
+            {
+                for (unsigned int k=0; k<results[s].size(); k++)
+                {
+                    const SweepResult& r = results[s][k];
+                    if (r.strategy != strategy || r.queries == 0)
+                        continue;
+
+                    x.push_back(r.distance * std::sqrt((double)r.n));
+                    y.push_back(m == 0 ? r.cost.ns
+                              : m == 1 ? r.cost.orientations
+                                       : r.cost.triangles);
+                }
+            }
+
+            double a, b, r2;
+            fitLine(x, y, a, b, r2);
+
+            std::cout << boost::format("%-12s %-13s %12.4f %12.2f %8.4f\n")
+                         % strategyName(strategy) % measures[m] % a % b % r2;
+        }
+    }
+
+    return 0;
+}
+
+/*****************************************************************************/
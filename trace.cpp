@@ -0,0 +1,426 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Recording walk queries to a binary log and replaying them headlessly.
+******************************************************************************/
+
+#include <cstring>
+#include <iostream>
+#include <boost/format.hpp>
+
+#include "benchmark.h"
+#include "trace.h"
+
+/*****************************************************************************/
+
+static const char    TRACE_MAGIC[4]  = { 'W', 'T', 'R', 'C' };
+static const quint64 TRACE_VERSION   = 1;
+static const int     TRACE_BLOCK     = 1 << 16;
+
+/*****************************************************************************/
+
+TraceWriter::TraceWriter()
+{
+}
+
+/*****************************************************************************/
+
+TraceWriter::~TraceWriter()
+{
+    close();
+}
+
+/*****************************************************************************/
+
+bool TraceWriter::open(const QString& filename, const TraceHeader& header)
+{
+    file.setFileName(filename);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+        return false;
+
+    buffer.clear();
+    buffer.append(TRACE_MAGIC, 4);
+    writeVarint(TRACE_VERSION);
+    writeVarint(header.distribution);
+    writeVarint(header.n);
+    writeVarint(header.seed);
+
+    return true;
+}
+
+/*****************************************************************************/
+
+void TraceWriter::write(const TraceRecord& r)
+{
+    writeVarint(r.strategy);
+    writeVarint(r.walkSeed);
+    writeVarint(r.startFace);
+    writeDouble(r.x);
+    writeDouble(r.y);
+    writeVarint(r.ns);
+    writeVarint(r.orientations);
+    writeVarint(r.faces.size());
+
+    for (unsigned int i=0; i<r.faces.size(); i++)
+        writeVarint(r.faces[i]);
+
+    if (buffer.size() >= TRACE_BLOCK)
+        flush();
+}
+
+/*****************************************************************************/
+
+void TraceWriter::close()
+{
+    if (!file.isOpen())
+        return;
+
+    flush();
+    file.close();
+}
+
+/*****************************************************************************/
+
+void TraceWriter::writeVarint(quint64 value)
+{
+    while (value >= 0x80)
+    {
+        buffer.append((char)(value | 0x80));
+        value >>= 7;
+    }
+    buffer.append((char)value);
+}
+
+/*****************************************************************************/
+
+void TraceWriter::writeDouble(double value)
+{
+    // Targets are stored bit-exact, replay must walk to the same point.
+    buffer.append((const char*)&value, sizeof(double));
+}
+
+/*****************************************************************************/
+
+void TraceWriter::flush()
+{
+    file.write(buffer);
+    buffer.clear();
+}
+
+/*****************************************************************************/
+
+TraceReader::TraceReader()
+{
+    position = 0;
+}
+
+/*****************************************************************************/
+
+bool TraceReader::open(const QString& filename, TraceHeader& header)
+{
+    file.setFileName(filename);
+    if (!file.open(QIODevice::ReadOnly))
+        return false;
+
+    buffer.clear();
+    position = 0;
+
+    char magic[4];
+    for (int i=0; i<4; i++)
+    {
+        quint8 byte;
+        if (!readByte(byte))
+            return false;
+        magic[i] = byte;
+    }
+
+    quint64 version, distribution, n, seed;
+    if (memcmp(magic, TRACE_MAGIC, 4) != 0
+        || !readVarint(version) || version != TRACE_VERSION
+        || !readVarint(distribution)
+        || !readVarint(n)
+        || !readVarint(seed))
+        return false;
+
+    header.distribution = distribution;
+    header.n            = n;
+    header.seed         = seed;
+
+    return true;
+}
+
+/*****************************************************************************/
+
+TraceStatus TraceReader::read(TraceRecord& r)
+{
+    if (remaining() == 0)
+        return TRACE_END;
+
+    quint64 strategy, walkSeed, startFace, ns, orientations, count;
+
+    if (!readVarint(strategy)
+        || !readVarint(walkSeed)
+        || !readVarint(startFace)
+        || !readDouble(r.x)
+        || !readDouble(r.y)
+        || !readVarint(ns)
+        || !readVarint(orientations)
+        || !readVarint(count)
+        || count > (quint64)remaining())
+        return TRACE_CORRUPT;
+
+    r.strategy     = strategy;
+    r.walkSeed     = walkSeed;
+    r.startFace    = startFace;
+    r.ns           = ns;
+    r.orientations = orientations;
+    r.faces.resize(count);
+
+    for (unsigned int i=0; i<count; i++)
+    {
+        quint64 face;
+        if (!readVarint(face) || face > 0xffffffffu)
+            return TRACE_CORRUPT;
+        r.faces[i] = face;
+    }
+
+    return TRACE_RECORD;
+}
+
+/*****************************************************************************/
+
+qint64 TraceReader::remaining() const
+{
+    return (buffer.size() - position) + (file.size() - file.pos());
+}
+
+/*****************************************************************************/
+
+bool TraceReader::readByte(quint8& byte)
+{
+    if (position >= buffer.size())
+    {
+        buffer   = file.read(TRACE_BLOCK);
+        position = 0;
+        if (buffer.isEmpty())
+            return false;
+    }
+
+    byte = buffer[position++];
+    return true;
+}
+
+/*****************************************************************************/
+
+bool TraceReader::readVarint(quint64& value)
+{
+    value = 0;
+    for (int shift=0; shift<64; shift+=7)
+    {
+        quint8 byte;
+        if (!readByte(byte))
+            return false;
+
+        value |= (quint64)(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+            return true;
+    }
+    return false;
+}
+
+/*****************************************************************************/
+
+bool TraceReader::readDouble(double& value)
+{
+    char bytes[sizeof(double)];
+    for (unsigned int i=0; i<sizeof(double); i++)
+    {
+        quint8 byte;
+        if (!readByte(byte))
+            return false;
+        bytes[i] = byte;
+    }
+    memcpy(&value, bytes, sizeof(double));
+    return true;
+}
+
+/*****************************************************************************/
+
+// Record a stream of queries for every strategy.
+//
+//  --record         Output file.
+//  --n              Number of points in the triangulation.
+//  --queries        Number of queries, each is run with every strategy.
+//  --seed           Seed for the pointset, the queries and the walks.
+//  --distributions  Name of the point distribution (the first one is used).
+int runRecord(const QStringList& args)
+{
+    QString      filename  = argValue(args, "--record");
+    int          n         = argValue(args, "--n",       "10000").toInt();
+    int          queries   = argValue(args, "--queries", "1000" ).toInt();
+    unsigned int seed      = argValue(args, "--seed",    "1"    ).toUInt();
+    QList<int>   dists     = argDistributions(args);
+
+    silenceDebugOutput();
+
+    TraceHeader header;
+    header.distribution = dists.isEmpty() ? UNIFORM_SQUARE : dists[0];
+    header.n            = n;
+    header.seed         = seed;
+
+    TraceWriter writer;
+    if (!writer.open(filename, header))
+    {
+        std::cerr << "Could not write " << filename.toStdString() << std::endl;
+        return 1;
+    }
+
+    Delaunay dt;
+    buildTriangulation(&dt, header.distribution, n, seed);
+    FaceIndex<Delaunay> index(&dt);
+
+    std::vector<Point>       targets;
+    std::vector<Face_handle> starts;
+    makeQueries(&dt, header.distribution, queries, seed, targets, starts);
+
+    QList<Face_handle> faces;
+    QElapsedTimer      timer;
+    TraceRecord        r;
+
+    for (unsigned int i=0; i<targets.size(); i++)
+    {
+        for (int s=0; s<NUM_STRATEGIES; s++)
+        {
+            r.strategy  = s;
+            r.walkSeed  = seed + i;
+            r.startFace = index.id(starts[i]);
+            r.x         = targets[i].x();
+            r.y         = targets[i].y();
+
+            timer.start();
+            r.orientations = runWalk(s, targets[i], &dt, starts[i],
+                                     r.walkSeed, faces);
+            r.ns = timer.nsecsElapsed();
+
+            r.faces.resize(faces.size());
+            for (int j=0; j<faces.size(); j++)
+                r.faces[j] = index.id(faces[j]);
+
+            writer.write(r);
+        }
+    }
+
+    writer.close();
+
+    std::cout << boost::format("Recorded %d walks on %d %s points to %s\n")
+                 % (targets.size() * NUM_STRATEGIES)
+                 % n
+                 % distributionName(header.distribution)
+                 % filename.toStdString();
+
+    return 0;
+}
+
+/*****************************************************************************/
+
+// Re-run a recorded stream and compare face sequences and timings against
+// it. Exits with 1 if any walk visited different faces, or if the log is
+// truncated or corrupt.
+//
+//  --replay         File written by --record.
+int runReplay(const QStringList& args)
+{
+    QString filename = argValue(args, "--replay");
+
+    silenceDebugOutput();
+
+    TraceHeader header;
+    TraceReader reader;
+    if (!reader.open(filename, header))
+    {
+        std::cerr << "Could not read " << filename.toStdString() << std::endl;
+        return 1;
+    }
+
+    Delaunay dt;
+    buildTriangulation(&dt, header.distribution, header.n, header.seed);
+    FaceIndex<Delaunay> index(&dt);
+
+    long long walks    [NUM_STRATEGIES] = {0};
+    long long different[NUM_STRATEGIES] = {0};
+    double    before   [NUM_STRATEGIES] = {0};
+    double    after    [NUM_STRATEGIES] = {0};
+
+    QList<Face_handle> faces;
+    QElapsedTimer      timer;
+    TraceRecord        r;
+
+    TraceStatus status;
+    long long   record;
+    for (record=0; (status = reader.read(r)) == TRACE_RECORD; record++)
+    {
+        if (r.strategy >= NUM_STRATEGIES || r.startFace >= index.size())
+        {
+            std::cerr << "Trace does not match this triangulation."
+                      << std::endl;
+            return 1;
+        }
+
+        Point       p(r.x, r.y);
+        Face_handle start = index.face(r.startFace);
+
+        timer.start();
+        runWalk(r.strategy, p, &dt, start, r.walkSeed, faces);
+        qint64 ns = timer.nsecsElapsed();
+
+        bool same = (faces.size() == (int)r.faces.size());
+        for (int j=0; same && j<faces.size(); j++)
+            same = (index.id(faces[j]) == r.faces[j]);
+
+        if (!same && different[r.strategy]++ < 10)
+        {
+            std::cout << boost::format("Record %d (%s, seed %d): "
+                                       "%d faces, expected %d\n")
+                         % record
+                         % strategyName(r.strategy)
+                         % r.walkSeed
+                         % faces.size()
+                         % r.faces.size();
+        }
+
+        walks [r.strategy]++;
+        before[r.strategy] += r.ns;
+        after [r.strategy] += ns;
+    }
+
+    if (status == TRACE_CORRUPT)
+    {
+        std::cerr << boost::format("Trace is truncated or corrupt at record "
+                                   "%d.\n") % record;
+        return 1;
+    }
+
+    std::cout << boost::format("%-12s %10s %10s %14s %14s %8s\n")
+                 % "strategy" % "walks" % "different"
+                 % "baseline ns" % "current ns" % "ratio";
+
+    long long total = 0;
+    for (int s=0; s<NUM_STRATEGIES; s++)
+    {
+        if (walks[s] == 0)
+            continue;
+
+        std::cout << boost::format("%-12s %10d %10d %14.1f %14.1f %8.3f\n")
+                     % strategyName(s)
+                     % walks[s]
+                     % different[s]
+                     % (before[s] / walks[s])
+                     % (after[s]  / walks[s])
+                     % (after[s]  / before[s]);
+
+        total += different[s];
+    }
+
+    return total == 0 ? 0 : 1;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,138 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Compact binary logs of walk queries and the faces they visited.
+*
+* A log starts with a header describing how to rebuild the triangulation,
+* followed by one record per walk. Integers are written as LEB128 varints
+* and faces are identified by their position in dt->all_faces_begin(), which
+* is stable when the same points are inserted in the same order.
+*
+******************************************************************************/
+
+#ifndef TRACE_H
+#define TRACE_H
+
+/*****************************************************************************/
+
+#include <vector>
+
+#include <QFile>
+#include <QByteArray>
+#include <QString>
+
+#include <CGAL/Unique_hash_map.h>
+
+/*****************************************************************************/
+
+struct TraceHeader
+{
+    quint32                 distribution;
+    quint32                 n;
+    quint32                 seed;
+};
+
+/*****************************************************************************/
+
+struct TraceRecord
+{
+    quint32                 strategy;
+    quint32                 walkSeed;
+    quint32                 startFace;
+    double                  x;
+    double                  y;
+    quint64                 ns;
+    quint32                 orientations;
+    std::vector<quint32>    faces;
+};
+
+/******************************************************************************
+* Streaming writer. Records are buffered and flushed in large blocks so that
+* logging does not dominate the cost of short walks.
+******************************************************************************/
+
+class TraceWriter
+{
+public:
+                            TraceWriter();
+                           ~TraceWriter();
+    bool                    open(const QString& filename,
+                                 const TraceHeader& header);
+    void                    write(const TraceRecord& record);
+    void                    close();
+
+private:
+    void                    writeVarint(quint64 value);
+    void                    writeDouble(double value);
+    void                    flush();
+
+    QFile                   file;
+    QByteArray              buffer;
+};
+
+/******************************************************************************
+* Streaming reader, the inverse of TraceWriter.
+******************************************************************************/
+
+// What TraceReader::read() found.
+enum TraceStatus
+{
+    TRACE_RECORD = 0,       // A whole record.
+    TRACE_END,              // The end of the log, between records.
+    TRACE_CORRUPT           // A truncated or malformed record.
+};
+
+class TraceReader
+{
+public:
+                            TraceReader();
+    bool                    open(const QString& filename, TraceHeader& header);
+    TraceStatus             read(TraceRecord& record);
+
+private:
+    // Bytes not yet read, each face of a record takes at least one.
+    qint64                  remaining() const;
+
+    bool                    readByte(quint8& byte);
+    bool                    readVarint(quint64& value);
+    bool                    readDouble(double& value);
+
+    QFile                   file;
+    QByteArray              buffer;
+    int                     position;
+};
+
+/******************************************************************************
+* Stable integer ids for the faces of a triangulation.
+******************************************************************************/
+
+template <typename T>
+class FaceIndex
+{
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::All_faces_iterator              All_faces_iterator;
+
+public:
+    FaceIndex(T* dt)
+    {
+        All_faces_iterator i;
+        for (i = dt->all_faces_begin(); i != dt->all_faces_end(); ++i)
+        {
+            ids[i] = faces.size();
+            faces.push_back(i);
+        }
+    }
+
+    quint32                 id(Face_handle f)       { return ids[f];      }
+    Face_handle             face(quint32 id)  const { return faces[id];   }
+    quint32                 size()            const { return faces.size(); }
+
+private:
+    std::vector<Face_handle>                        faces;
+    CGAL::Unique_hash_map<Face_handle, quint32>     ids;
+};
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -0,0 +1,175 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Builds a random triangulation on a worker thread.
+******************************************************************************/
+
+#include <vector>
+
+#include <CGAL/spatial_sort.h>
+
+#include "triangulation_builder.h"
+#include "parallel_delaunay.h"
+#include "session.h"
+
+/*****************************************************************************/
+
+TriangulationBuilder::TriangulationBuilder(int          points,
+                                           int          distribution,
+                                           unsigned int seed,
+                                           QObject*     parent)
+    : QThread(parent)
+{
+    this->points       = points;
+    this->distribution = distribution;
+    this->seed         = seed;
+    resolution         = 0;
+    cancelled          = 0;
+    dt                 = 0;
+    grid               = 0;
+}
+
+/*****************************************************************************/
+
+TriangulationBuilder::TriangulationBuilder(const QString& session,
+                                           int            gridResolution,
+                                           QObject*       parent)
+    : QThread(parent)
+{
+    this->session      = session;
+    resolution         = gridResolution;
+    points             = 0;
+    distribution       = 0;
+    seed               = 0;
+    cancelled          = 0;
+    dt                 = 0;
+    grid               = 0;
+}
+
+/*****************************************************************************/
+
+TriangulationBuilder::~TriangulationBuilder()
+{
+    cancel();
+    wait();
+
+    // Anything that was not taken is ours to delete.
+    delete grid;
+    delete dt;
+}
+
+/*****************************************************************************/
+
+void TriangulationBuilder::cancel()
+{
+    cancelled = 1;
+}
+
+/*****************************************************************************/
+
+Delaunay* TriangulationBuilder::takeTriangulation()
+{
+    Delaunay* result = dt;
+    dt = 0;
+    return result;
+}
+
+/*****************************************************************************/
+
+GridIndex<Delaunay>* TriangulationBuilder::takeGridIndex()
+{
+    GridIndex<Delaunay>* result = grid;
+    grid = 0;
+    return result;
+}
+
+/*****************************************************************************/
+
+void TriangulationBuilder::run()
+{
+    Delaunay* t = session.isEmpty() ? generate() : load();
+    if (!t)
+        return;
+
+    GridIndex<Delaunay>* g = new GridIndex<Delaunay>(t, resolution);
+
+    if (cancelled)
+    {
+        delete g;
+        delete t;
+        return;
+    }
+
+    dt   = t;
+    grid = g;
+
+    emit progress(100);
+    emit built();
+}
+
+/*****************************************************************************/
+
+Delaunay* TriangulationBuilder::generate()
+{
+    std::vector<Point> pts;
+    generatePoints(distribution, points, seed, pts);
+
+    Delaunay* t     = new Delaunay();
+    int       cores = QThread::idealThreadCount();
+
+    if (cores > 1 && points >= PARALLEL_MIN_POINTS * cores)
+    {
+        // Large inputs are built in parallel, which cannot report progress
+        // or stop part way through.
+        emit progress(5);
+        parallelInsert(t, pts, cores);
+        emit progress(95);
+    }
+    else
+    {
+        // Sorting along a space filling curve keeps consecutive points close,
+        // so each insertion only walks a short way from the last one.
+        CGAL::spatial_sort(pts.begin(), pts.end());
+
+        emit progress(5);
+
+        Face_handle hint;
+        for (int begin=0; begin < points; begin += BUILD_CHUNK)
+        {
+            if (cancelled)
+            {
+                delete t;
+                return 0;
+            }
+
+            int end = qMin(begin + BUILD_CHUNK, points);
+            for (int i=begin; i<end; i++)
+                hint = t->insert(pts[i], hint)->face();
+
+            emit progress(5 + (90 * end) / points);
+        }
+    }
+
+    return t;
+}
+
+/*****************************************************************************/
+
+// Reading cannot report progress or stop part way, but it is linear in the
+// size of the file and does no geometry.
+Delaunay* TriangulationBuilder::load()
+{
+    emit progress(5);
+
+    Delaunay* t = new Delaunay();
+    if (!readSessionTriangulation(session, t))
+    {
+        delete t;
+        emit failed();
+        return 0;
+    }
+
+    emit progress(95);
+    return t;
+}
+
+/*****************************************************************************/
@@ -0,0 +1,90 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Builds a random triangulation on a worker thread.
+*
+* Points are inserted in chunks, reporting progress after each one and
+* stopping early if cancelled. The finished triangulation and its seeding
+* index are handed over to the GUI thread, which swaps them in. A builder
+* can instead read the triangulation saved in a session file.
+*
+******************************************************************************/
+
+#ifndef TRIANGULATION_BUILDER_H
+#define TRIANGULATION_BUILDER_H
+
+/*****************************************************************************/
+
+#include <QThread>
+#include <QAtomicInt>
+
+#include "mainwindow.h"
+#include "grid_index.h"
+
+/*****************************************************************************/
+
+// Number of points inserted between progress reports and cancel checks.
+const int BUILD_CHUNK = 20000;
+
+/*****************************************************************************/
+
+class TriangulationBuilder : public QThread
+{
+    Q_OBJECT
+
+signals:
+    // Percentage of the build that is done.
+    void                            progress(int percent);
+
+    // Emitted once the triangulation is complete. Not emitted if the build
+    // was cancelled.
+    void                            built();
+
+    // Emitted if a session could not be read.
+    void                            failed();
+
+public:
+                                    TriangulationBuilder(
+                                        int          points,
+                                        int          distribution,
+                                        unsigned int seed,
+                                        QObject*     parent=0);
+
+    // Read the triangulation of a session file, and build a grid of the
+    // given resolution (0 for the default) over it.
+                                    TriangulationBuilder(
+                                        const QString& session,
+                                        int            gridResolution,
+                                        QObject*       parent=0);
+                                   ~TriangulationBuilder();
+
+    // Ask the build to stop. Safe to call from any thread.
+    void                            cancel();
+
+    // Ownership of the results passes to the caller. These return 0 until
+    // built() has been emitted.
+    Delaunay*                       takeTriangulation();
+    GridIndex<Delaunay>*            takeGridIndex();
+
+protected:
+    void                            run();
+
+private:
+    // The triangulation to hand over, or null if cancelled or failed.
+    Delaunay*                       generate();
+    Delaunay*                       load();
+
+    int                             points;
+    int                             distribution;
+    unsigned int                    seed;
+    QString                         session;
+    int                             resolution;
+    QAtomicInt                      cancelled;
+    Delaunay*                       dt;
+    GridIndex<Delaunay>*            grid;
+};
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/
@@ -13,6 +13,9 @@
 
 /*****************************************************************************/
 
+#include <ctime>
+#include <algorithm>
+
 #include <CGAL/Qt/Converter.h>
 #include <CGAL/Random.h>
 #include <CGAL/Qt/GraphicsViewNavigation.h>
@@ -25,8 +28,13 @@
 
 #include <QList>
 
+#include "compact_trace.h"
+
 /*****************************************************************************/
 
+// Number of entries in the per-walk orientation cache. Must be a power of 2.
+const int ORIENTATION_CACHE_SIZE = 32;
+
 /******************************************************************************
 * Abstract class to contain different walking strategies
 ******************************************************************************/
@@ -35,7 +43,9 @@ template <typename T>
 class Walk
 {
     typedef typename T::Face                            Face;
+    typedef typename T::Point                           Point;
     typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
     typedef typename T::Line_face_circulator            Lfc;
     typedef typename T::Geom_traits                     Gt;
     
@@ -47,6 +57,15 @@ public:
     int                             getNumTrianglesVisited();
     int                             getNumOrientationsPerformed();
     
+    // Number of orientations answered by the cache instead of being 
+    // performed.
+    int                             getNumOrientationCacheHits();
+    
+    // The faces visited by this walk, in order. The list is decoded from
+    // the compact trace on first use.
+    const QList<Face_handle>&       getFaces() const;
+    const CompactTrace<T>&          getTrace() const;
+    
     // Static helper function to draw 2D faces to QgrahpicsItems.
     static QGraphicsPolygonItem*    drawTriangle(Face_handle f,
                                                  QPen        pen   = QPen(), 
@@ -60,15 +79,58 @@ protected:
     // Doing this enables the base-class functions to work.
     void                            addToWalk(Face_handle f);
     
-    CGAL::Orientation               orientation(Point p, Point q, Point r);    
+    // All predicates go through the triangulation's traits, so walks can be
+    // instantiated over any kernel.
+    CGAL::Orientation               orientation(const Point& p, 
+                                                const Point& q, 
+                                                const Point& r);
     
+    // Orientation of the target p relative to the edge (a,b). A walk only
+    // has one target, so results are cached by edge for the rest of the 
+    // walk and an edge that is tested again, from either side, is free.
+    CGAL::Orientation               orientation(Vertex_handle a,
+                                                Vertex_handle b,
+                                                const Point&  p);
     
 private:
-    // List of faces this walk intersects.
-    QList<Face_handle>              faces;
+    // Faces this walk intersects, and their decoded form for getFaces().
+    CompactTrace<T>                 trace;
+    mutable QList<Face_handle>      faces;
     
     int o_count;
+    int o_hits;
+    
+    // Direct-mapped cache of edge orientations, keyed on the vertices of 
+    // the edge in address order.
+    struct CachedOrientation
+    {
+        const void*                 a;
+        const void*                 b;
+        CGAL::Orientation           o;
+    };
+    
+    CachedOrientation               o_cache[ORIENTATION_CACHE_SIZE];
+    
+};
+
+/******************************************************************************
+* Abstract source of start faces. Walks can be given one of these instead of
+* a start face, and ask it for a face close to their target.
+******************************************************************************/
+
+template <typename T>
+class StartFaceOracle
+{
+public:
+    virtual                         ~StartFaceOracle() {}
     
+    // Return a face near p to start a walk towards p from.
+    virtual typename T::Face_handle startFace(const typename T::Point& p) = 0;
+
+    // Told the face containing p by walks that started from this oracle and
+    // end there. Oracles that learn from past queries can keep it.
+    virtual void                    walkEnded(const typename T::Point&,
+                                              typename T::Face_handle) {}
 };
 
 /******************************************************************************
@@ -85,7 +147,15 @@ class StraightWalk : public Walk<T>
     typedef typename T::Geom_traits                     Gt;
     
 public:    
-    StraightWalk(Point p, T* dt, Face_handle f=Face_handle())
+    // The seed is unused, it is accepted so that all walks can be
+    // constructed in the same way. The walk runs on past p, so it does not
+    // tell the oracle where it ended.
+    StraightWalk(Point p, T* dt, StartFaceOracle<T>* oracle,
+                 unsigned int seed=time(NULL))
+        : StraightWalk(p, dt, oracle->startFace(p), seed) {}
+    
+    StraightWalk(Point p, T* dt, Face_handle f=Face_handle(), 
+                 unsigned int seed=time(NULL))
     {
         // Store a reference to the triangulation.
         this->dt = dt;
@@ -106,7 +176,7 @@ public:
         {    
             do {
                 Face_handle f = lfc;
-                addToWalk(f);        
+                this->addToWalk(f);        
             } while (++lfc != done);          
         }
     }
@@ -116,35 +186,84 @@ public:
 * Pivot Walk strategy
 ******************************************************************************/
 
+// The default step budget of a pivot walk is this many steps per vertex of
+// the triangulation, about two per face, plus PIVOT_BUDGET_MIN. No walk
+// should come close to it, it only stops a walk that has gone wrong from
+// running forever. Vertices are counted because number_of_faces() walks
+// the convex hull, which would cost every walk O(n) on points in convex
+// position.
+const int PIVOT_BUDGET_PER_VERTEX = 4;
+const int PIVOT_BUDGET_MIN        = 64;
+
+/*****************************************************************************/
+
+// What a pivot walk did to reach its target.
+struct PivotStatistics
+{
+    int     pivots;         // Number of pivots walked around.
+    int     triangles;      // Triangles visited while turning about pivots.
+    int     saved;          // Orientations skipped by the first step.
+    int     lost;           // Skipped tests that had to be done after all.
+    int     steps;          // Steps taken, counted against the budget.
+    bool    completed;      // False if the walk ran out of budget.
+    
+    double  trianglesPerPivot() const
+    {
+        return pivots > 0 ? triangles / (double)pivots : 0;
+    }
+};
+
+/*****************************************************************************/
+
 template <typename T>
 class PivotWalk : public Walk<T>
 {
     typedef typename T::Face                            Face;
     typedef typename T::Point                           Point;    
     typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
     typedef typename T::Geom_traits                     Gt;    
 
 private: 
     // We store the pivot points for this walk so we can draw them later.
     QList<Point> pivots;
     
+    PivotStatistics stats;
+    
 public:    
     
     /*************************************************************************/
         
-    PivotWalk(Point p, T* dt, Face_handle f=Face_handle())
+    PivotWalk(Point p, T* dt, StartFaceOracle<T>* oracle,
+              unsigned int seed=time(NULL), int budget=0)
+        : PivotWalk(p, dt, oracle->startFace(p), seed, budget)
+    {
+        if (stats.completed)
+            oracle->walkEnded(p, this->getTrace().back());
+    }
+    
+    /*************************************************************************/
+    
+    // A budget of 0 uses the default, see PIVOT_BUDGET_PER_VERTEX.
+    PivotWalk(Point p, T* dt, Face_handle f=Face_handle(), 
+              unsigned int seed=time(NULL), int budget=0)
     {
         
-        // Create a binary random number generator.
-        CGAL::Random random(time(NULL));
+        // Create a binary random number generator. Walks with the same 
+        // seed visit the same faces.
+        CGAL::Random random(seed);
 
         // Statistics gathering.
-        int pivots_passed     = 0;
-        int triangles_visited = 0;
-        int or_saved          = 0;
-        int or_lost           = 0;
-                
-        bool new_pivot = true;
+        stats.pivots    = 0;
+        stats.triangles = 0;
+        stats.saved     = 0;
+        stats.lost      = 0;
+        stats.steps     = 0;
+        stats.completed = false;
+        
+        if (budget <= 0)
+            budget = PIVOT_BUDGET_MIN 
+                   + PIVOT_BUDGET_PER_VERTEX * dt->number_of_vertices();
         
         this->dt = dt;
 
@@ -160,11 +279,9 @@ public:
         // **     FIND FIRST FACE      ** //
         for (int i=0; i<3; i++)
         {
-            const Point & p0 = c->vertex(i)->point();
-            const Point & p1 = c->vertex(c->cw(i))->point();
-                                    
             // If we have found a face that can see the point.
-            if ( orientation(p0,p1,p) == CGAL::POSITIVE )
+            if ( this->orientation(c->vertex(i), c->vertex(c->cw(i)), p) 
+                                                            == CGAL::POSITIVE )
             {
                 c    = c->neighbor(c->ccw(i));
                 break;
@@ -175,14 +292,14 @@ public:
         
         bool clockwise = TRUE;
         
-        for (int x=0; x<100; x++)
+        while (stats.steps++ < budget)
         {
             // First thing to do is choose a direction. We use the value of
             // clockwise to decide this.  But may have to swap depending on 
             // the configuation of the points.            
             clockwise = random.get_bool();
                         
-            addToWalk(c);
+            this->addToWalk(c);
             
             // Assume we have just walked into a new cell. The first thing 
             // to do is decide a direction.
@@ -192,15 +309,15 @@ public:
             int i = c->index(prev);            
             
             // Pivot point.
-            const Point & p_pivot = c->vertex(i)->point();                        
+            Vertex_handle p_pivot = c->vertex(i);
             
             // Point linking the pivot to the clockwise face.
             // ** Note ** cw and ccw are reversed when we are converting 
             // between a face index and a point index.
-            const Point & p_cw = c->vertex(c->ccw(i))->point();
+            Vertex_handle p_cw = c->vertex(c->ccw(i));
             
             // Point linking the pivot to the counter-clockwise face.
-            const Point & p_ccw = c->vertex(c->cw(i))->point();
+            Vertex_handle p_ccw = c->vertex(c->cw(i));
             
             
             if (clockwise)
@@ -208,7 +325,7 @@ public:
                 
                 // If visibility does hold in this direction, continue 
                 // walking around this point.
-                if (orientation(p_pivot, p_cw, p) == CGAL::RIGHT_TURN )
+                if (this->orientation(p_pivot, p_cw, p) == CGAL::RIGHT_TURN )
                 {
                     prev = c;
                     c    = c->neighbor(c->cw(i));
@@ -216,7 +333,8 @@ public:
 
                 // If visibility does hold in this direction, continue 
                 // walking around this point
-                else if (orientation(p_pivot, p_ccw, p) == CGAL::LEFT_TURN)
+                else if (this->orientation(p_pivot, p_ccw, p) 
+                                                            == CGAL::LEFT_TURN)
                 {
                     prev = c;
                     c    = c->neighbor(c->ccw(i));
@@ -226,14 +344,17 @@ public:
                 // If both of the above tests failed, then we know that 
                 // the point is here.
                 else 
+                {
+                    stats.completed = true;
                     break;
+                }
 
               
             } else { /* SAME BUT ORDER REVERSED */
                                 
                 // If visibility does hold in this direction, continue
                 // walking around this point
-                if ( orientation(p_pivot, p_ccw, p) == CGAL::LEFT_TURN)
+                if ( this->orientation(p_pivot, p_ccw, p) == CGAL::LEFT_TURN)
                 {
                     prev = c;
                     c    = c->neighbor(c->ccw(i));
@@ -241,7 +362,8 @@ public:
                                 
                 // If visibility does hold in this direction, continue 
                 // walking around this point
-                else if ( orientation(p_pivot, p_cw, p) == CGAL::RIGHT_TURN)
+                else if ( this->orientation(p_pivot, p_cw, p) 
+                                                           == CGAL::RIGHT_TURN)
                 {
                     prev = c;
                     c    = c->neighbor(c->cw(i));   
@@ -252,11 +374,14 @@ public:
                 // If both of the above tests failed, then we know that the
                 // point is here.
                 else 
-                    break;             
+                {
+                    stats.completed = true;
+                    break;
+                }
             }
             
-            pivots.append(p_pivot);                         
-            addToWalk(c);            
+            pivots.append(p_pivot->point());
+            this->addToWalk(c);            
                         
             // We should now be going in a good direction in the cell about 
             // some pivot point p_pivot. We continue in the direction given 
@@ -267,41 +392,43 @@ public:
             bool done = false;
             
             // Statistics gathering.                    
-            pivots_passed++;
+            stats.pivots++;
 
             // This is where we would have gone if the first test failed!
-            Face_handle omitted_next;
-            Point       p_omitted;
-            Point       p_omitted_final;
+            Face_handle   omitted;
+            Face_handle   omitted_next;
+            Vertex_handle p_omitted;
+            Vertex_handle p_omitted_final;
 
-            for (int y=0; y<100; y++)
+            for (int y=0; stats.steps++ < budget; y++)
             {                
                 // Index of the previous triangle relative to the current 
                 // triangle.
                 i = c->index(prev);
                 
                 // Stastics gathering //
-                triangles_visited++;                                
-                if (y==2) or_saved++;
+                stats.triangles++;                                
+                if (y==2) stats.saved++;
                 //                    //
                 
                 if (clockwise)               
                 { 
                     // This is the point on the edge that we are going to test.
-                    const Point & p_current = c->vertex(i)->point();
+                    Vertex_handle p_current = c->vertex(i);
                     
                     if (y == 0)
                     {
                         // We might need to come back to this test.
+                        omitted         = c;
                         omitted_next    = c->neighbor(c->cw(i));          
                         p_omitted       = p_current; 
-                        p_omitted_final = c->vertex(c->ccw(i))->point();                        
+                        p_omitted_final = c->vertex(c->ccw(i));
                         prev            = c;
                         c               = c->neighbor(c->ccw(i));                                 
                     }
                     
                     // If we can see the point through this edge
-                    else if (y!=0 && orientation(p_pivot, p_current, p)
+                    else if (y!=0 && this->orientation(p_pivot, p_current, p)
                                      == CGAL::RIGHT_TURN)
                     {
                         // continue in this direction.
@@ -318,17 +445,21 @@ public:
                         // we do not have to go back.    
                         if (y == 1)
                         {
-                            if (orientation(p_pivot, p_omitted, p) 
+                            if (this->orientation(p_pivot, p_omitted, p) 
                                                             == CGAL::LEFT_TURN)
                             {
                                 // If we reach this point, we have had to 
                                 // backtrack through the skipped triangle.
-                                or_lost++;
+                                stats.lost++;
                                 
-                                if (orientation(p_omitted, p_omitted_final, p) 
+                                if (this->orientation(p_omitted, 
+                                                      p_omitted_final, p) 
                                                             == CGAL::LEFT_TURN)
                                 {
-                                    // We are done;
+                                    // We are done, in the skipped triangle.
+                                    prev = c;
+                                    c    = omitted;
+                                    this->addToWalk(c);
                                     done = true;
                                     break;
                                 }
@@ -343,8 +474,8 @@ public:
                         // We have reached the sink node. Check to see if the 
                         // point is contained. If not then start from the 
                         // beginning.
-                        const Point & p_final = c->vertex(c->ccw(i))->point();
-                        if (orientation(p_current, p_final, p) 
+                        Vertex_handle p_final = c->vertex(c->ccw(i));
+                        if (this->orientation(p_current, p_final, p) 
                                                             == CGAL::LEFT_TURN)
                         {
                             // We are done;
@@ -363,20 +494,21 @@ public:
                 } else { /* SAME with orientations reversed */
                     
                     // This is the point on the edge that we are going to test.
-                    const Point & p_current = c->vertex(i)->point();
+                    Vertex_handle p_current = c->vertex(i);
 
                     if (y == 0)
                     {
                         // We might need to come back to this test.
+                        omitted         = c;
                         omitted_next    = c->neighbor(c->ccw(i));          
                         p_omitted       = p_current;
-                        p_omitted_final = c->vertex(c->cw(i))->point();
+                        p_omitted_final = c->vertex(c->cw(i));
                         prev            = c;
                         c               = c->neighbor(c->cw(i));
                     }                        
                         
                     // If we can see the point through this edge
-                    else if (y!=0 && orientation(p_pivot, p_current, p) 
+                    else if (y!=0 && this->orientation(p_pivot, p_current, p) 
                                                             == CGAL::LEFT_TURN)
                     {
                         // continue in this direction.
@@ -386,15 +518,19 @@ public:
                     } else {
                         if (y==1)
                         {
-                            if (orientation(p_pivot, p_omitted, p) 
+                            if (this->orientation(p_pivot, p_omitted, p) 
                                                             == CGAL::RIGHT_TURN)
                             {
-                                or_lost++;
+                                stats.lost++;
                                 
-                                if (orientation(p_omitted, p_omitted_final, p) 
+                                if (this->orientation(p_omitted, 
+                                                      p_omitted_final, p) 
                                                             == CGAL::RIGHT_TURN)                        
                                 {
-                                    // We are done;
+                                    // We are done, in the skipped triangle.
+                                    prev = c;
+                                    c    = omitted;
+                                    this->addToWalk(c);
                                     done = true;
                                     break;
                                 }
@@ -408,8 +544,8 @@ public:
                         // We have reached the sink node. Check to see if the 
                         // point is contained. If not then start from the 
                         // beginning.
-                        const Point & p_final = c->vertex(c->cw(i))->point();
-                        if (orientation(p_current, p_final, p) == 
+                        Vertex_handle p_final = c->vertex(c->cw(i));
+                        if (this->orientation(p_current, p_final, p) == 
                                                               CGAL::RIGHT_TURN)
                         {
                             // We are done;
@@ -424,19 +560,23 @@ public:
                     }                        
                 }
                 
-                addToWalk(c);                            
+                this->addToWalk(c);                            
             }
             
             
             if (done) 
+            {
+                stats.completed = true;
                 break;            
-            
+            }
         }
-        
-        qDebug() << triangles_visited/(float)pivots_passed;
-        qDebug() << "Lost: " << or_lost;
-        qDebug() << "Saved: " << or_saved;
-      
+    }
+    
+    /*************************************************************************/
+    
+    const PivotStatistics& getStatistics() const
+    {
+        return stats;
     }
     
     /*************************************************************************/
@@ -469,54 +609,129 @@ public:
         }
         return g;
     }
-    
+
     /*************************************************************************/
-    
+
+    // The pivot points, in the order they were used.
+    const QList<Point>& getPivots() const
+    {
+        return pivots;
+    }
+
+    /*************************************************************************/
+
 };
 
 
 /******************************************************************************
 * Visibility walk strategy
+*
+* On a Delaunay triangulation the visibility walk never visits a face twice.
+* On other triangulations it can cycle, so each attempt is given a budget of
+* steps. When the budget runs out the walk is restarted from its start face
+* with fresh random choices and twice the budget, and after the last restart
+* it finishes with a straight walk, which terminates on any triangulation.
+*
 ******************************************************************************/
 
+// Steps allowed to the first attempt of a visibility walk are this plus
+// VISIBILITY_BUDGET_PER_VERTEX times the number of vertices. A triangulation
+// of n vertices has fewer than 2n faces, counting the infinite ones, so a
+// walk that never visits a face twice cannot run out. Walks on points in
+// convex position take O(n) steps and must not be cut short.
+const int VISIBILITY_BUDGET_MIN        = 64;
+const int VISIBILITY_BUDGET_PER_VERTEX = 2;
+
+// Randomised restarts before falling back to a straight walk.
+const int VISIBILITY_RESTARTS          = 2;
+
+/*****************************************************************************/
+
 template <typename T>
 class VisibilityWalk : public Walk<T>
 {
     typedef typename T::Face                            Face;
     typedef typename T::Point                           Point;    
     typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+    typedef typename T::Line_face_circulator            Lfc;
     typedef typename T::Geom_traits                     Gt;    
     
+private:
+    // Number of times the walk was restarted, and whether it had to finish
+    // with a straight walk.
+    int  restarts;
+    bool fell_back;
+    
 public:    
-    VisibilityWalk(Point p, T* dt, Face_handle f=Face_handle())
+    VisibilityWalk(Point p, T* dt, StartFaceOracle<T>* oracle,
+                   unsigned int seed=time(NULL))
+        : VisibilityWalk(p, dt, oracle->startFace(p), seed)
+    {
+        oracle->walkEnded(p, this->getTrace().back());
+    }
+    
+    VisibilityWalk(Point p, T* dt, Face_handle f=Face_handle(), 
+                   unsigned int seed=time(NULL))
     {
 
-        this->dt = dt;
+        this->dt  = dt;
+        restarts  = 0;
+        fell_back = false;
 
         // The user did not provide a face handle. So just use the infinite 
         // face.
         if (f==Face_handle())
             f=dt->infinite_face();
 
+        // Create a binary random number generator. Walks with the same 
+        // seed visit the same faces.
+        CGAL::Random random(seed);
+
+        int budget = VISIBILITY_BUDGET_MIN
+                   + VISIBILITY_BUDGET_PER_VERTEX * dt->number_of_vertices();
+
+        while (!walk(p, f, random, budget))
+        {
+            if (restarts == VISIBILITY_RESTARTS)
+            {
+                fell_back = true;
+                straightWalk(p, f);
+                break;
+            }
+            
+            // A new stream of choices, so the restart does not repeat the
+            // same attempt.
+            random  = CGAL::Random(random.get_int(0, 1<<30));
+            budget *= 2;
+            restarts++;
+        }
+    }
+    
+    /*************************************************************************/
+    
+    int  getNumRestarts()  const { return restarts;  }
+    bool usedFallback()    const { return fell_back; }
+    
+private:
+    
+    /*************************************************************************/
+    
+    // One attempt at the walk from f. Returns false if it ran out of steps.
+    bool walk(const Point& p, Face_handle f, CGAL::Random& random, int budget)
+    {
+        T* dt = this->dt;
+        
         // This is where we store the current face.
         Face_handle    c = f;  
         Face_handle prev = c;  
 
-
-        // Create a binary random number generator.
-        CGAL::Random random(time(NULL));
-
-
-
         // **     FIND FIRST FACE      ** //
         for (int i=0; i<3; i++)
         {
-            const Point & p0 = c->vertex(i       )->point();
-            const Point & p1 = c->vertex(c->cw(i))->point();
-            
-            
             // If we have found a face that can see the point.
-            if ( orientation(p0,p1,p) == CGAL::POSITIVE )
+            if ( this->orientation(c->vertex(i), c->vertex(c->cw(i)), p) 
+                                                            == CGAL::POSITIVE )
             {
                 c = c->neighbor(c->ccw(i));
                 break;
@@ -526,15 +741,15 @@ public:
 
 
         // Loop until we find our destination point.
-        while (1)
+        for (int steps=0; steps<budget; steps++)
         { 
-            addToWalk(c);            
+            this->addToWalk(c);            
 
             int i = c->index(prev);
 
-            const Point & p0 = c->vertex( i          )->point();
-            const Point & p1 = c->vertex( dt->cw(i)  )->point();
-            const Point & p2 = c->vertex( dt->ccw(i) )->point();
+            Vertex_handle p0 = c->vertex( i          );
+            Vertex_handle p1 = c->vertex( dt->cw(i)  );
+            Vertex_handle p2 = c->vertex( dt->ccw(i) );
 
             int left_first   = random.get_bool();
 
@@ -543,13 +758,13 @@ public:
             if (left_first)
             {
                 
-            	if ( orientation(p0,p1,p) == CGAL::POSITIVE ) {  
+            	if ( this->orientation(p0,p1,p) == CGAL::POSITIVE ) {  
                     prev = c;
                     c = c->neighbor( dt->ccw(i) );  
                     continue;
         	    }                
         	    
-            	if ( orientation(p2,p0,p) == CGAL::POSITIVE ) {  
+            	if ( this->orientation(p2,p0,p) == CGAL::POSITIVE ) {  
                     prev = c;            	    
                     c = c->neighbor( dt->cw(i) );  
                     continue;
@@ -557,13 +772,13 @@ public:
         	            	                    
             } else {
                                      	    
-            	if ( orientation(p2,p0,p) == CGAL::POSITIVE ) {  
+            	if ( this->orientation(p2,p0,p) == CGAL::POSITIVE ) {  
                     prev = c;            	    
                     c = c->neighbor( dt->cw(i) );  
                     continue;
         	    }
         	            	    
-            	if ( orientation(p0,p1,p) == CGAL::POSITIVE ) {  
+            	if ( this->orientation(p0,p1,p) == CGAL::POSITIVE ) {  
                     prev = c;            	    
                     c = c->neighbor( dt->ccw(i) );  
                     continue;
@@ -574,15 +789,59 @@ public:
             // If neither of the above tests failed,
             // then we do one final test to check to see
             // whether or not we have arrived.
-        	if ( orientation(p2,p1,p) == CGAL::POSITIVE ) {  
+        	if ( this->orientation(p2,p1,p) == CGAL::POSITIVE ) {  
                 prev = c;            	      
-                break;
+                return true;
     	    }
 
         }    
-
+        
+        return false;
+    }
+    
+    /*************************************************************************/
+    
+    // Finish with CGAL's line walk from f, stopping at the face containing
+    // p. Unlike the visibility walk this cannot cycle.
+    void straightWalk(const Point& p, Face_handle f)
+    {
+        T* dt = this->dt;
+        
+        int j = dt->is_infinite(f->vertex(0)) ? 1 : 0;
+        
+        // A line walk needs two distinct points.
+        if (f->vertex(j)->point() == p)
+        {
+            this->addToWalk(f);
+            return;
+        }
+        
+        Lfc lfc = dt->line_walk(f->vertex(j)->point(), p, f), done(lfc);
+        if (lfc == 0)
+            return;
+        
+        do {
+            Face_handle g = lfc;
+            this->addToWalk(g);
+            
+            if (!dt->is_infinite(g) && contains(g, p))
+                return;
+            
+        } while (++lfc != done);
+    }
+    
+    /*************************************************************************/
+    
+    bool contains(Face_handle g, const Point& p)
+    {
+        for (int i=0; i<3; i++)
+            if (this->orientation(g->vertex(g->ccw(i)), 
+                                  g->vertex(g->cw(i)), p) == CGAL::NEGATIVE)
+                return false;
+        return true;
     }
     
+    /*************************************************************************/
 
 };
 
@@ -595,19 +854,55 @@ public:
 ******************************************************************************/
 
 template <typename T>  
-CGAL::Orientation Walk<T>::orientation(Point p, Point q, Point r)
+CGAL::Orientation Walk<T>::orientation(const Point& p, 
+                                       const Point& q, 
+                                       const Point& r)
 {
     o_count++;
     
-    return CGAL::orientation(p,q,r);
+    return dt->geom_traits().orientation_2_object()(p,q,r);
+    
+}
+
+
+/*****************************************************************************/  
+
+template <typename T>  
+CGAL::Orientation Walk<T>::orientation(Vertex_handle a,
+                                       Vertex_handle b,
+                                       const Point&  p)
+{
+    const void* va = &*a;
+    const void* vb = &*b;
+    
+    // Store each edge once, whichever way round it is tested.
+    bool swapped = vb < va;
+    if (swapped)
+        std::swap(va, vb);
+    
+    size_t slot = (((size_t)va >> 4) ^ ((size_t)vb >> 3)) 
+                                            & (ORIENTATION_CACHE_SIZE-1);
+    CachedOrientation& entry = o_cache[slot];
+    
+    if (entry.a == va && entry.b == vb)
+    {
+        o_hits++;
+    } else {
+        entry.a = va;
+        entry.b = vb;
+        entry.o = swapped ? orientation(b->point(), a->point(), p)
+                          : orientation(a->point(), b->point(), p);
+    }
     
+    return swapped ? CGAL::opposite(entry.o) : entry.o;
 }
 
+/*****************************************************************************/  
 
 template <typename T>  
 void Walk<T>::addToWalk(Face_handle f)
 {
-    faces.append(f);
+    trace.append(f);
 }
 
 /*****************************************************************************/  
@@ -616,7 +911,33 @@ void Walk<T>::addToWalk(Face_handle f)
 template <typename T>  
 int Walk<T>::getNumTrianglesVisited()
 {
-    return faces.size();
+    return trace.size();
+}
+
+/*****************************************************************************/  
+
+template <typename T>  
+const QList<typename T::Face_handle>& Walk<T>::getFaces() const
+{
+    if (faces.size() != trace.size())
+    {
+        faces.clear();
+        faces.reserve(trace.size());
+        
+        typename CompactTrace<T>::const_iterator i;
+        for (i = trace.begin(); i != trace.end(); ++i)
+            faces.append(*i);
+    }
+    
+    return faces;
+}
+
+/*****************************************************************************/  
+
+template <typename T>  
+const CompactTrace<T>& Walk<T>::getTrace() const
+{
+    return trace;
 }
 
 /*****************************************************************************/  
@@ -629,8 +950,8 @@ QGraphicsItemGroup* Walk<T>::getGraphics( QPen pen, QBrush brush )
     QGraphicsItemGroup* g = new QGraphicsItemGroup();
         
     // Iterate over faces in this walk.
-    typename QList<typename T::Face_handle>::const_iterator i;
-    for (i = faces.begin(); i != faces.end(); ++i)
+    typename CompactTrace<T>::const_iterator i;
+    for (i = trace.begin(); i != trace.end(); ++i)
     {
         // Draw this triangle in the walk.
         if (! dt->is_infinite( *i ) ) 
@@ -649,6 +970,10 @@ template <typename T>
 Walk<T>::Walk()
 {
     o_count=0;
+    o_hits =0;
+    
+    for (int i=0; i<ORIENTATION_CACHE_SIZE; i++)
+        o_cache[i].a = o_cache[i].b = 0;
 }
 
 /*****************************************************************************/  
@@ -661,6 +986,14 @@ int Walk<T>::getNumOrientationsPerformed()
 
 /*****************************************************************************/  
 
+template <typename T>
+int Walk<T>::getNumOrientationCacheHits()
+{
+    return o_hits;
+}
+
+/*****************************************************************************/  
+
 // Helper-function to create a triangle graphics item.
 // Note that this is publically accessible and static.
 template <typename T>
@@ -0,0 +1,516 @@
+/******************************************************************************
+* Written by Ross Hemsley for INRIA.fr.
+* Walks as resumable state machines, for running many queries interleaved.
+*
+* The walks in walk.h run to completion in their constructors, so a cache
+* miss on one face stalls the whole walk. A stepper instead takes one step
+* at a time and keeps its state between steps. A scheduler can then run
+* many walks round-robin, prefetching the next face of each walk (and then
+* its vertices) and moving on to another walk while the memory arrives.
+*
+* Steppers do not record the faces they visit, they only report where they
+* finish and how many orientations they needed.
+*
+******************************************************************************/
+
+#ifndef WALK_STEPPER_H
+#define WALK_STEPPER_H
+
+/*****************************************************************************/
+
+#include <vector>
+#include <algorithm>
+
+#include <CGAL/Random.h>
+
+/*****************************************************************************/
+
+#if defined(__GNUC__)
+#define WALK_PREFETCH(address) __builtin_prefetch(address)
+#else
+#define WALK_PREFETCH(address)
+#endif
+
+/******************************************************************************
+* State shared by all of the steppers.
+******************************************************************************/
+
+template <typename T>
+class WalkStepper
+{
+protected:
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+
+public:
+    bool                            done()            const { return finished; }
+    Face_handle                     face()            const { return c;        }
+    int                             getNumOrientationsPerformed() const
+                                                            { return o_count;  }
+
+    // Ask for the face the next step will read.
+    void prefetchFace() const
+    {
+        WALK_PREFETCH(&*c);
+    }
+
+    // Ask for the vertices of the face the next step will read. This reads
+    // the face, so should follow prefetchFace() after a delay.
+    void prefetchVertices() const
+    {
+        WALK_PREFETCH(&*c->vertex(0));
+        WALK_PREFETCH(&*c->vertex(1));
+        WALK_PREFETCH(&*c->vertex(2));
+    }
+
+protected:
+    WalkStepper(const Point& p, T* dt, Face_handle f)
+        : p(p), dt(dt), c(f), prev(f), started(false), finished(false),
+          o_count(0), steps(0)
+    {
+        if (c == Face_handle())
+            c = prev = dt->infinite_face();
+
+        // A safety net against walks that cycle on broken input. There are
+        // about twice as many faces as vertices, and number_of_faces() is
+        // not constant time.
+        budget = 64 + 4 * dt->number_of_vertices();
+    }
+
+    CGAL::Orientation orientation(Vertex_handle a,
+                                  Vertex_handle b,
+                                  const Point&  q)
+    {
+        o_count++;
+        return dt->geom_traits().orientation_2_object()(a->point(),
+                                                        b->point(), q);
+    }
+
+    // Move from the start face to a neighbour that can see p, as the walks
+    // in walk.h do. Returns false if no edge can see p, in which case p is
+    // in the start face.
+    bool firstStep()
+    {
+        started = true;
+
+        for (int i=0; i<3; i++)
+        {
+            if (orientation(c->vertex(i), c->vertex(c->cw(i)), p)
+                                                            == CGAL::POSITIVE)
+            {
+                c = c->neighbor(c->ccw(i));
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Count a step, giving up when over budget.
+    bool overBudget()
+    {
+        if (++steps <= budget)
+            return false;
+
+        finished = true;
+        return true;
+    }
+
+    Point                           p;
+    T*                              dt;
+    Face_handle                     c;
+    Face_handle                     prev;
+    bool                            started;
+    bool                            finished;
+    int                             o_count;
+    int                             steps;
+    int                             budget;
+};
+
+/******************************************************************************
+* Straight walk, following CGAL's line walk until the face containing p.
+******************************************************************************/
+
+template <typename T>
+class StraightStepper : public WalkStepper<T>
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Line_face_circulator            Lfc;
+
+public:
+    StraightStepper(const Point& p, T* dt, Face_handle f=Face_handle(),
+                    unsigned int seed=0)
+        : WalkStepper<T>(p, dt, f) {}
+
+    void step()
+    {
+        if (this->done() || this->overBudget())
+            return;
+
+        T* dt = this->dt;
+
+        if (!this->started)
+        {
+            this->started = true;
+
+            Face_handle f = this->c;
+            int         j = dt->is_infinite(f->vertex(0)) ? 1 : 0;
+
+            if (f->vertex(j)->point() == this->p)
+            {
+                this->finished = true;
+                return;
+            }
+
+            lfc     = dt->line_walk(f->vertex(j)->point(), this->p, f);
+            lfc_end = lfc;
+            if (lfc == 0)
+            {
+                this->finished = true;
+                return;
+            }
+            this->c = lfc;
+        }
+        else
+        {
+            if (++lfc == lfc_end)
+            {
+                this->finished = true;
+                return;
+            }
+            this->c = lfc;
+        }
+
+        if (!dt->is_infinite(this->c) && contains(this->c))
+            this->finished = true;
+    }
+
+private:
+    bool contains(Face_handle g)
+    {
+        for (int i=0; i<3; i++)
+            if (this->orientation(g->vertex(g->ccw(i)), g->vertex(g->cw(i)),
+                                  this->p) == CGAL::NEGATIVE)
+                return false;
+        return true;
+    }
+
+    Lfc                             lfc;
+    Lfc                             lfc_end;
+};
+
+/******************************************************************************
+* Visibility walk, one face per step.
+******************************************************************************/
+
+template <typename T>
+class VisibilityStepper : public WalkStepper<T>
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+
+public:
+    VisibilityStepper(const Point& p, T* dt, Face_handle f=Face_handle(),
+                      unsigned int seed=0)
+        : WalkStepper<T>(p, dt, f), random(seed) {}
+
+    void step()
+    {
+        if (this->done() || this->overBudget())
+            return;
+
+        if (!this->started)
+        {
+            this->finished = !this->firstStep();
+            return;
+        }
+
+        Face_handle& c    = this->c;
+        Face_handle& prev = this->prev;
+        const Point& p    = this->p;
+
+        int i = c->index(prev);
+
+        Vertex_handle p0 = c->vertex( i         );
+        Vertex_handle p1 = c->vertex( c->cw(i)  );
+        Vertex_handle p2 = c->vertex( c->ccw(i) );
+
+        // The same randomised order of tests as VisibilityWalk.
+        if (random.get_bool())
+        {
+            if (this->orientation(p0,p1,p) == CGAL::POSITIVE) {
+                prev = c; c = c->neighbor(c->ccw(i)); return;
+            }
+            if (this->orientation(p2,p0,p) == CGAL::POSITIVE) {
+                prev = c; c = c->neighbor(c->cw(i));  return;
+            }
+        } else {
+            if (this->orientation(p2,p0,p) == CGAL::POSITIVE) {
+                prev = c; c = c->neighbor(c->cw(i));  return;
+            }
+            if (this->orientation(p0,p1,p) == CGAL::POSITIVE) {
+                prev = c; c = c->neighbor(c->ccw(i)); return;
+            }
+        }
+
+        // Neither edge can see p, so this face contains it.
+        this->finished = true;
+    }
+
+private:
+    CGAL::Random                    random;
+};
+
+/******************************************************************************
+* Pivot walk. A step is one pass of either loop of PivotWalk: choosing the
+* direction about a new pivot, or turning one face about the current one.
+******************************************************************************/
+
+template <typename T>
+class PivotStepper : public WalkStepper<T>
+{
+    typedef typename T::Point                           Point;
+    typedef typename T::Face_handle                     Face_handle;
+    typedef typename T::Vertex_handle                   Vertex_handle;
+
+public:
+    PivotStepper(const Point& p, T* dt, Face_handle f=Face_handle(),
+                 unsigned int seed=0)
+        : WalkStepper<T>(p, dt, f), random(seed), turning(false) {}
+
+    void step()
+    {
+        if (this->done() || this->overBudget())
+            return;
+
+        if (!this->started)
+        {
+            this->finished = !this->firstStep();
+            return;
+        }
+
+        if (turning)
+            turn();
+        else
+            choosePivot();
+    }
+
+private:
+    /*************************************************************************/
+
+    void choosePivot()
+    {
+        Face_handle& c    = this->c;
+        Face_handle& prev = this->prev;
+        const Point& p    = this->p;
+
+        clockwise = random.get_bool();
+
+        int i = c->index(prev);
+
+        pivot = c->vertex(i);
+        Vertex_handle p_cw  = c->vertex(c->ccw(i));
+        Vertex_handle p_ccw = c->vertex(c->cw(i));
+
+        if (clockwise)
+        {
+            if (this->orientation(pivot, p_cw, p) == CGAL::RIGHT_TURN)
+            {
+                prev = c; c = c->neighbor(c->cw(i));
+            }
+            else if (this->orientation(pivot, p_ccw, p) == CGAL::LEFT_TURN)
+            {
+                prev = c; c = c->neighbor(c->ccw(i));
+                clockwise = false;
+            }
+            else
+            {
+                this->finished = true;
+                return;
+            }
+        } else {
+            if (this->orientation(pivot, p_ccw, p) == CGAL::LEFT_TURN)
+            {
+                prev = c; c = c->neighbor(c->ccw(i));
+            }
+            else if (this->orientation(pivot, p_cw, p) == CGAL::RIGHT_TURN)
+            {
+                prev = c; c = c->neighbor(c->cw(i));
+                clockwise = true;
+            }
+            else
+            {
+                this->finished = true;
+                return;
+            }
+        }
+
+        turning = true;
+        y       = 0;
+    }
+
+    /*************************************************************************/
+
+    void turn()
+    {
+        Face_handle& c    = this->c;
+        Face_handle& prev = this->prev;
+        const Point& p    = this->p;
+
+        // Orientations that mean "keep turning", and "p is past the edge",
+        // in the current direction.
+        CGAL::Orientation forward  = clockwise ? CGAL::RIGHT_TURN
+                                               : CGAL::LEFT_TURN;
+        CGAL::Orientation backward = clockwise ? CGAL::LEFT_TURN
+                                               : CGAL::RIGHT_TURN;
+
+        int i    = c->index(prev);
+        int next = clockwise ? c->ccw(i) : c->cw(i);
+        int back = clockwise ? c->cw(i)  : c->ccw(i);
+
+        Vertex_handle p_current = c->vertex(i);
+
+        if (y == 0)
+        {
+            // Skip the first test, we might have to come back to it.
+            omitted         = c;
+            omitted_next    = c->neighbor(back);
+            p_omitted       = p_current;
+            p_omitted_final = c->vertex(next);
+            prev            = c;
+            c               = c->neighbor(next);
+            y++;
+            return;
+        }
+
+        if (this->orientation(pivot, p_current, p) == forward)
+        {
+            prev = c;
+            c    = c->neighbor(next);
+            y++;
+            return;
+        }
+
+        turning = false;
+
+        if (y == 1 && this->orientation(pivot, p_omitted, p) == backward)
+        {
+            // Either p is in the skipped face, or we go on past it.
+            if (this->orientation(p_omitted, p_omitted_final, p) == backward)
+            {
+                prev           = c;
+                c              = omitted;
+                this->finished = true;
+            }
+            else
+                c = omitted_next;
+            return;
+        }
+
+        // The sink of this pivot. Either p is here, or we start again with
+        // a new pivot.
+        Vertex_handle p_final = c->vertex(next);
+        if (this->orientation(p_current, p_final, p) == backward)
+        {
+            this->finished = true;
+            return;
+        }
+
+        prev = c;
+        c    = c->neighbor(back);
+    }
+
+    /*************************************************************************/
+
+    CGAL::Random                    random;
+    bool                            turning;
+    bool                            clockwise;
+    int                             y;
+    Vertex_handle                   pivot;
+    Face_handle                     omitted;
+    Face_handle                     omitted_next;
+    Vertex_handle                   p_omitted;
+    Vertex_handle                   p_omitted_final;
+};
+
+/******************************************************************************
+* Schedulers
+******************************************************************************/
+
+// Run each walk to completion in turn.
+template <typename S>
+void runSequential(std::vector<S>& walks)
+{
+    for (unsigned int i=0; i<walks.size(); i++)
+        while (!walks[i].done())
+            walks[i].step();
+}
+
+/*****************************************************************************/
+
+// Keep up to width walks in flight, visiting them round-robin. Each visit
+// either prefetches the vertices of the face a walk is about to read (its
+// face was prefetched on the previous visit), or takes a step and then
+// prefetches the new face. Finished walks are replaced from the queue.
+template <typename S>
+void runInterleaved(std::vector<S>& walks, int width)
+{
+    int n    = walks.size();
+    int next = std::min(width, n);
+
+    std::vector<int>  slots;
+    std::vector<bool> ready;
+    for (int i=0; i<next; i++)
+    {
+        slots.push_back(i);
+        ready.push_back(false);
+        walks[i].prefetchFace();
+    }
+
+    while (!slots.empty())
+    {
+        for (unsigned int k=0; k<slots.size(); )
+        {
+            S& w = walks[slots[k]];
+
+            if (!ready[k])
+            {
+                w.prefetchVertices();
+                ready[k] = true;
+                k++;
+                continue;
+            }
+
+            w.step();
+            ready[k] = false;
+
+            if (!w.done())
+            {
+                w.prefetchFace();
+                k++;
+                continue;
+            }
+
+            // Replace the finished walk, or close the slot.
+            if (next < n)
+            {
+                slots[k] = next++;
+                walks[slots[k]].prefetchFace();
+                k++;
+            }
+            else
+            {
+                slots.erase(slots.begin() + k);
+                ready.erase(ready.begin() + k);
+            }
+        }
+    }
+}
+
+/*****************************************************************************/
+
+#endif
+
+/*****************************************************************************/